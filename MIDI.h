@@ -29,37 +29,28 @@
 
 
 #define COMPILE_MIDI_IN         1           // Set this setting to 1 to use the MIDI input.
-#define COMPILE_MIDI_OUT        0           // Set this setting to 1 to use the MIDI output. 
-#define COMPILE_MIDI_THRU       0           // Set this setting to 1 to use the MIDI Soft Thru feature
+#define COMPILE_MIDI_OUT        1           // Set this setting to 1 to use the MIDI output. 
+#define COMPILE_MIDI_THRU       1           // Set this setting to 1 to use the MIDI Soft Thru feature
                                             // Please note that the Thru will work only when both COMPILE_MIDI_IN and COMPILE_MIDI_OUT set to 1.
 
 
-#define USE_SERIAL_PORT         Serial      // Change the number (to Serial1 for example) if you want
-                                            // to use a different serial port for MIDI I/O.
+// The serial port, buffer sizes and parsing options are chosen per instance: see MIDI_DefaultSettings below.
 
 
-#define USE_RUNNING_STATUS		1			// Running status enables short messages when sending multiple values
-                                            // of the same type and channel.
-                                            // Set to 0 if you have troubles with controlling you hardware.
-
-
-#define USE_CALLBACKS           1           // Set this to 1 if you want to use callback handlers (to bind your functions to the library).
+#ifndef USE_CALLBACKS
+#define USE_CALLBACKS           0           // Set this to 1 if you want to use callback handlers (to bind your functions to the library).
                                             // To use the callbacks, you need to have COMPILE_MIDI_IN set to 1
-
-#define USE_1BYTE_PARSING       1           // Each call to MIDI.read will only parse one byte (might be faster).
+                                            // MIDI_Static binds handlers at compile time and does not need them (SysEx chunk streaming does).
+#endif
 
 
 // END OF CONFIGURATION AREA 
 // (do not modify anything under this line unless you know what you are doing)
 
 
-#define MIDI_BAUDRATE			31250
-
 #define MIDI_CHANNEL_OMNI		0
 #define MIDI_CHANNEL_OFF		17			// and over
 
-#define MIDI_SYSEX_ARRAY_SIZE	255			// Maximum size is 65535 bytes.
-
 /*! Type definition for practical use (because "unsigned char" is a bit long to write.. )*/
 typedef uint8_t byte;
 typedef uint16_t word;
@@ -106,8 +97,7 @@ struct midimsg {
 	byte data1;
 	/*! The second data byte. If the message is only 2 bytes long, this one is null.\n Value goes from 0 to 127. */
 	byte data2;
-	/*! System Exclusive dedicated byte array. \n Array length is stocked on 16 bits, in data1 (LSB) and data2 (MSB) */
-	byte sysex_array[MIDI_SYSEX_ARRAY_SIZE];
+	/*! For System Exclusive, the array length is stocked on 16 bits, in data1 (LSB) and data2 (MSB). The array itself is read in place with getSysExArray(). */
 	/*! This boolean indicates if the message is valid or not. There is no channel consideration here, validity means the message respects the MIDI norm. */
 	bool valid;
 };
@@ -115,21 +105,71 @@ struct midimsg {
 
 
 
+/*! The midistats structure counts what the input had to throw away. See getInputStats(). */
+struct midistats {
+	/*! Bytes discarded because the serial receive buffer was full, and the rest of the message they cut short. */
+	unsigned long bytesDiscarded;
+	/*! Estimated number of messages those bytes (and any message they interrupted) held. */
+	unsigned int messagesLost;
+	/*! Number of times the receive buffer was found full. */
+	unsigned int overflows;
+	/*! The most bytes ever found waiting in the receive buffer. */
+	byte rxHighWater;
+};
+
+
+/*! \brief Per instance settings for MIDI_Class.
+ 
+ To change some of them, derive a struct from this one and redefine the constants you need, eg:
+ struct BigSysEx : MIDI_DefaultSettings { static const unsigned int SysExArraySize = 1024; };
+ */
+struct MIDI_DefaultSettings {
+	/*! Running status enables short messages when sending multiple values of the same type and channel.
+	 Set to false if you have troubles with controlling you hardware. */
+	static const bool UseRunningStatus = true;
+	/*! Parse the data bytes of 3 byte channel messages under running status without re-deriving their type and length. */
+	static const bool UseRunningStatusFastPath = true;
+	/*! Each call to read() will only parse one byte (might be faster). */
+	static const bool Use1ByteParsing = true;
+	/*! Size of the pending message buffer, which holds whole SysEx messages. Maximum size is 65535 bytes. */
+	static const unsigned int SysExArraySize = 255;
+	/*! Size of the transport's receive ring buffer. The ring keeps one slot free, so it is full at RxBufferSize - 1 bytes. */
+	static const int RxBufferSize = 128;
+	/*! Default number of bytes a call to readBatch() may consume. */
+	static const unsigned int BatchSize = 32;
+	/*! Rate the transport is started at by begin(). */
+	static const long BaudRate = 31250;
+};
+
+
 /*! \brief The main class for MIDI handling.\n
 	See member descriptions to know how to use it,
 	or check out the examples supplied with the library.
+ 
+ Transport is the serial port type, eg HardwareSerial. It needs begin(long), available(), read() and write(byte).
+ Settings is MIDI_DefaultSettings or a struct derived from it.
+ Declare an instance with its port, eg: MIDI_Class<HardwareSerial> MIDI(Serial);
  */
+template<class Transport, class Settings = MIDI_DefaultSettings>
 class MIDI_Class {
 	
 	
 public:
 	// Constructor and Destructor
-	MIDI_Class();
+	MIDI_Class(Transport &inSerial);
 	~MIDI_Class();
 	
 	
 	void begin(const byte inChannel = 1);
 	
+	Transport & getTransport() const { return mSerial; }
+	
+	
+protected:
+	
+	Transport &		mSerial;
+	
+	
 	
 	
 	
@@ -163,9 +203,7 @@ private:
 	
 	
 	// Attributes
-#if USE_RUNNING_STATUS
 	byte			mRunningStatus_TX;
-#endif // USE_RUNNING_STATUS
 
 #endif	// COMPILE_MIDI_OUT
 	
@@ -179,6 +217,9 @@ public:
 	bool read();
 	bool read(const byte Channel);
 	
+	unsigned int readBatch(unsigned int maxBytes = Settings::BatchSize);
+	unsigned int readBatch(const byte Channel, unsigned int maxBytes);
+	
 	// Getters
 	kMIDIType getType() const;
 	byte getChannel() const;
@@ -193,6 +234,9 @@ public:
         return mInputChannel;
     }
 	
+	const midistats & getInputStats() const { return mInputStats; }
+	void resetInputStats();
+	
 	// Setters
 	void setInputChannel(const byte Channel);
 	
@@ -221,7 +265,8 @@ public:
 	void setHandleProgramChange(void (*fptr)(byte channel, byte number));
 	void setHandleAfterTouchChannel(void (*fptr)(byte channel, byte pressure));
 	void setHandlePitchBend(void (*fptr)(byte channel, int bend));
-	void setHandleSystemExclusive(void (*fptr)(byte * array, byte size));
+	void setHandleSystemExclusive(void (*fptr)(byte * array, unsigned int size));
+	void setHandleSystemExclusiveChunk(void (*fptr)(const byte * chunk, unsigned int size, bool first, bool last));
 	void setHandleTimeCodeQuarterFrame(void (*fptr)(byte data));
 	void setHandleSongPosition(void (*fptr)(unsigned int beats));
 	void setHandleSongSelect(void (*fptr)(byte songnumber));
@@ -238,21 +283,35 @@ public:
 #endif // USE_CALLBACKS
 	
 	
-private:
+protected:
+	
+	int rx_available();
+	bool parse_next(byte inChannel);
+	bool accept(byte inChannel);
+	byte read_byte();
 	
 	bool input_filter(byte inChannel);
 	bool parse(byte inChannel);
+	bool parseByte(const byte extracted);
+	bool completeMessage();
+	bool check_overflow(int bytes_available);
 	void reset_input_attributes();
 	
 	// Attributes
 	byte			mRunningStatus_RX;
+	byte			mRunningStatusLength_RX;				// Length of the messages mRunningStatus_RX applies to, 0 if none.
+	byte			mSkipDataBytes_RX;						// Data bytes of a message lost in an overflow still to come, 0xFF until the next status.
 	byte			mInputChannel;
 	
-	byte			mPendingMessage[MIDI_SYSEX_ARRAY_SIZE];
+	byte			mPendingMessage[Settings::SysExArraySize];
 	unsigned int	mPendingMessageExpectedLenght;
 	unsigned int	mPendingMessageIndex;					// Extended to unsigned int for larger sysex payloads.
+	unsigned int	mSysExChunkStart;						// Start of the next SysEx chunk when streaming.
 	
 	midimsg			mMessage;
+	midistats		mInputStats;
+	
+private:
 	
 #if USE_CALLBACKS
 	
@@ -265,7 +324,8 @@ private:
 	void (*mProgramChangeCallback)(byte channel, byte);
 	void (*mAfterTouchChannelCallback)(byte channel, byte);
 	void (*mPitchBendCallback)(byte channel, int);
-	void (*mSystemExclusiveCallback)(byte * array, byte size);
+	void (*mSystemExclusiveCallback)(byte * array, unsigned int size);
+	void (*mSystemExclusiveChunkCallback)(const byte * chunk, unsigned int size, bool first, bool last);
 	void (*mTimeCodeQuarterFrameCallback)(byte data);
 	void (*mSongPositionCallback)(unsigned int beats);
 	void (*mSongSelectCallback)(byte songnumber);
@@ -291,6 +351,7 @@ public:
 	// Getters
 	kThruFilterMode getFilterMode() const { return mThruFilterMode; }
 	bool getThruState() const { return mThruActivated; }
+	bool getThruCutThrough() const { return mThruCutThrough; }
 	
 	
 	// Setters
@@ -298,19 +359,137 @@ public:
 	void turnThruOff();
 	
 	void setThruFilterMode(const kThruFilterMode inThruFilterMode);
+	void setThruCutThrough(bool inCutThrough);
 	
 	
-private:
+protected:
 	
 	void thru_filter(byte inChannel);
+	void thru_byte(byte extracted);
+	bool thru_passes(byte inStatus);
 	
 	bool				mThruActivated;
 	kThruFilterMode		mThruFilterMode;
+	bool				mThruCutThrough;
+	bool				mThruPassing;			// Cut-through: the bytes of the current message are forwarded.
+	byte				mThruStatus;			// Cut-through: running status of the forwarded messages.
 	
 #endif // Thru
 	
 };
 
-extern MIDI_Class MIDI;
+
+#if COMPILE_MIDI_IN
+
+/*! \brief Handler for MIDI_Static that ignores every message.
+ 
+ Derive your handler from it and declare static functions with the same names for the messages you want.
+ Anything you leave out resolves to one of these empty inline functions and compiles away.
+ */
+struct MIDI_NullHandler {
+	static inline void noteOff(byte channel, byte note, byte velocity) {}
+	static inline void noteOn(byte channel, byte note, byte velocity) {}
+	static inline void afterTouchPoly(byte channel, byte note, byte pressure) {}
+	static inline void controlChange(byte channel, byte number, byte value) {}
+	static inline void programChange(byte channel, byte number) {}
+	static inline void afterTouchChannel(byte channel, byte pressure) {}
+	static inline void pitchBend(byte channel, int bend) {}
+	static inline void systemExclusive(byte * array, unsigned int size) {}
+	static inline void timeCodeQuarterFrame(byte data) {}
+	static inline void songPosition(unsigned int beats) {}
+	static inline void songSelect(byte songnumber) {}
+	static inline void tuneRequest() {}
+	static inline void clock() {}
+	static inline void start() {}
+	static inline void continuePlaying() {}
+	static inline void stop() {}
+	static inline void activeSensing() {}
+	static inline void systemReset() {}
+};
+
+
+/*! \brief MIDI_Class with its handlers bound at compile time.
+ 
+ Handler is a type with static functions named as in MIDI_NullHandler. Messages are dispatched to them directly
+ from read() and readBatch(), with no function pointers: handlers can be inlined, and types the handler ignores cost nothing.
+ Everything else, including the runtime callbacks when USE_CALLBACKS is set, works as in MIDI_Class; but only the
+ compile time handlers are called by the reads below.
+ */
+template<class Handler, class Transport, class Settings = MIDI_DefaultSettings>
+class MIDI_Static : public MIDI_Class<Transport, Settings> {
+	
+public:
+	
+	MIDI_Static(Transport &inSerial) : MIDI_Class<Transport, Settings>(inSerial) {}
+	
+	bool read() { return read(this->getInputChannel()); }
+	
+	bool read(const byte inChannel)
+	{
+		if (inChannel >= MIDI_CHANNEL_OFF) return false; // MIDI Input disabled.
+		if (!this->parse(inChannel) || !this->accept(inChannel)) return false;
+		dispatch();
+		return true;
+	}
+	
+	unsigned int readBatch(unsigned int maxBytes = Settings::BatchSize) { return readBatch(this->getInputChannel(), maxBytes); }
+	
+	unsigned int readBatch(const byte inChannel, unsigned int maxBytes)
+	{
+		if (inChannel >= MIDI_CHANNEL_OFF) return 0; // MIDI Input disabled.
+		unsigned int messages = 0;
+		int bytes_available = this->rx_available();
+		while (maxBytes > 0 && bytes_available > 0) {
+			if (this->parse_next(inChannel)) {
+				dispatch();
+				messages++;
+			}
+			maxBytes--;
+			if (--bytes_available == 0) bytes_available = this->rx_available();
+		}
+		return messages;
+	}
+	
+private:
+	
+	// Most frequent messages first, as in launchCallback().
+	inline void dispatch()
+	{
+		const midimsg &msg = this->mMessage;
+		switch (msg.type) {
+			case NoteOff:				Handler::noteOff(msg.channel,msg.data1,msg.data2);	break;
+			case NoteOn:				Handler::noteOn(msg.channel,msg.data1,msg.data2);	break;
+			case ControlChange:			Handler::controlChange(msg.channel,msg.data1,msg.data2);	break;
+			
+			case Clock:					Handler::clock();			break;
+			case Start:					Handler::start();			break;
+			case Continue:				Handler::continuePlaying();	break;
+			case Stop:					Handler::stop();			break;
+			case ActiveSensing:			Handler::activeSensing();	break;
+			
+			case PitchBend:				Handler::pitchBend(msg.channel,(int)((msg.data1 & 0x7F) | ((msg.data2 & 0x7F)<< 7)) - 8192);	break;
+			case AfterTouchPoly:		Handler::afterTouchPoly(msg.channel,msg.data1,msg.data2);	break;
+			case AfterTouchChannel:		Handler::afterTouchChannel(msg.channel,msg.data1);	break;
+			case ProgramChange:			Handler::programChange(msg.channel,msg.data1);	break;
+			case SystemExclusive:		Handler::systemExclusive(this->mPendingMessage,this->getSysExArrayLength());	break;
+			
+			case TimeCodeQuarterFrame:	Handler::timeCodeQuarterFrame(msg.data1);	break;
+			case SongPosition:			Handler::songPosition((msg.data1 & 0x7F) | ((msg.data2 & 0x7F)<< 7));	break;
+			case SongSelect:			Handler::songSelect(msg.data1);	break;
+			case TuneRequest:			Handler::tuneRequest();	break;
+			case SystemReset:			Handler::systemReset();	break;
+			
+			case InvalidType:
+			default:
+				break;
+		}
+	}
+	
+};
+
+#endif // COMPILE_MIDI_IN
+
+
+#include "MIDI.hpp"
 
 #endif // LIB_MIDI_H_
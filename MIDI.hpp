@@ -0,0 +1,1593 @@
+/*!
+ *  @file		MIDI.hpp
+ *  Project		MIDI Library
+ *	@brief		MIDI Library for the Arduino
+ *	@version	3.2
+ *  @author		Francois Best 
+ *	@date		24/02/11
+ *  license		GPL Forty Seven Effects - 2011
+ */
+
+// Template definitions for MIDI.h, which includes this file. Do not include it directly.
+
+#include <stdlib.h>
+
+
+/*! \brief Constructor for MIDI_Class.
+ \param inSerial	The transport (usually a HardwareSerial such as Serial) the instance reads from and writes to.
+ */
+template<class Transport, class Settings>
+MIDI_Class<Transport, Settings>::MIDI_Class(Transport &inSerial) : mSerial(inSerial)
+{ 
+	
+#if USE_CALLBACKS
+	
+	// Initialise callbacks to NULL pointer
+	mNoteOffCallback				= NULL;
+	mNoteOnCallback					= NULL;
+	mAfterTouchPolyCallback			= NULL;
+	mControlChangeCallback			= NULL;
+	mProgramChangeCallback			= NULL;
+	mAfterTouchChannelCallback		= NULL;
+	mPitchBendCallback				= NULL;
+	mSystemExclusiveCallback		= NULL;
+	mSystemExclusiveChunkCallback	= NULL;
+	mTimeCodeQuarterFrameCallback	= NULL;
+	mSongPositionCallback			= NULL;
+	mSongSelectCallback				= NULL;
+	mTuneRequestCallback			= NULL;
+	mClockCallback					= NULL;
+	mStartCallback					= NULL;
+	mContinueCallback				= NULL;
+	mStopCallback					= NULL;
+	mActiveSensingCallback			= NULL;
+	mSystemResetCallback			= NULL;
+	
+#endif
+	
+}
+
+
+/*! \brief Default destructor for MIDI_Class.
+ 
+ This is not really useful for the Arduino, as it is never called...
+ */
+template<class Transport, class Settings>
+MIDI_Class<Transport, Settings>::~MIDI_Class()
+{
+
+}
+
+
+/*! \brief Call the begin method in the setup() function of the Arduino.
+ 
+ All parameters are set to their default values:
+ - Input channel set to 1 if no value is specified
+ - Full thru mirroring
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::begin(const byte inChannel)
+{
+	
+	// Initialise the Serial port
+	mSerial.begin(Settings::BaudRate);
+	
+	
+#if COMPILE_MIDI_OUT
+	
+	mRunningStatus_TX = InvalidType;
+	
+#endif // COMPILE_MIDI_OUT
+	
+	
+#if COMPILE_MIDI_IN
+	
+	mInputChannel = inChannel;
+	mRunningStatus_RX = InvalidType;
+	mRunningStatusLength_RX = 0;
+	mSkipDataBytes_RX = 0;
+	mPendingMessageIndex = 0;
+	mSysExChunkStart = 0;
+	mPendingMessageExpectedLenght = 0;
+	
+	mMessage.valid = false;
+	mMessage.type = InvalidType;
+	mMessage.channel = 0;
+	mMessage.data1 = 0;
+	mMessage.data2 = 0;
+	
+	resetInputStats();
+	
+#endif // COMPILE_MIDI_IN
+	
+	
+#if (COMPILE_MIDI_IN && COMPILE_MIDI_OUT && COMPILE_MIDI_THRU) // Thru
+	
+	mThruFilterMode = Full;
+	mThruActivated = true;
+	mThruCutThrough = false;
+	mThruPassing = false;
+	mThruStatus = InvalidType;
+	
+#endif // Thru
+	
+}
+
+
+#if COMPILE_MIDI_OUT
+
+// Private method for generating a status byte from channel and type
+template<class Transport, class Settings>
+const byte MIDI_Class<Transport, Settings>::genstatus(const kMIDIType inType,
+								 const byte inChannel) const
+{
+	
+	return ((byte)inType | ((inChannel-1) & 0x0F));
+	
+}
+
+
+/*! \brief Generate and send a MIDI message from the values given.
+ \param type	The message type (see type defines for reference)
+ \param data1	The first data byte.
+ \param data2	The second data byte (if the message contains only 1 data byte, set this one to 0).
+ \param channel	The output channel on which the message will be sent (values from 1 to 16). Note: you cannot send to OMNI.
+ 
+ This is an internal method, use it only if you need to send raw data from your code, at your own risks.
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::send(kMIDIType type,
+					  byte data1,
+					  byte data2,
+					  byte channel)
+{
+	
+	// Then test if channel is valid
+	if (channel >= MIDI_CHANNEL_OFF || channel == MIDI_CHANNEL_OMNI || type < NoteOff) {
+		
+		mRunningStatus_TX = InvalidType;
+		
+		return; // Don't send anything
+	}
+	
+	if (type <= PitchBend) {
+		// Channel messages
+		
+		// Protection: remove MSBs on data
+		data1 &= 0x7F;
+		data2 &= 0x7F;
+		
+		byte statusbyte = genstatus(type,channel);
+		
+		if (Settings::UseRunningStatus) {
+			// Check Running Status
+			if (mRunningStatus_TX != statusbyte) {
+				// New message, memorise and send header
+				mRunningStatus_TX = statusbyte;
+				mSerial.write(mRunningStatus_TX);
+			}
+		}
+		else {
+			// Don't care about running status, send the Control byte.
+			// Still remember it, the cut-through Thru needs to know the receiver's running status.
+			mSerial.write(statusbyte);
+			mRunningStatus_TX = statusbyte;
+		}
+		
+		// Then send data
+		mSerial.write(data1);
+		if (type != ProgramChange && type != AfterTouchChannel) {
+			mSerial.write(data2);
+		}
+		return;
+	}
+	if (type >= TuneRequest && type <= SystemReset) {
+		// System Real-time and 1 byte.
+		sendRealTime(type);
+	}
+	
+}
+
+
+/*! \brief Send a Note On message 
+ \param NoteNumber	Pitch value in the MIDI format (0 to 127). Take a look at the values, names and frequencies of notes here: http://www.phys.unsw.edu.au/jw/notes.html\n
+ \param Velocity	Note attack velocity (0 to 127). A NoteOn with 0 velocity is considered as a NoteOff.
+ \param Channel		The channel on which the message will be sent (1 to 16). 
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendNoteOn(byte NoteNumber,
+							byte Velocity,
+							byte Channel)
+{ 
+	
+	send(NoteOn,NoteNumber,Velocity,Channel);
+
+}
+
+
+/*! \brief Send a Note Off message (a real Note Off, not a Note On with null velocity)
+ \param NoteNumber	Pitch value in the MIDI format (0 to 127). Take a look at the values, names and frequencies of notes here: http://www.phys.unsw.edu.au/jw/notes.html\n
+ \param Velocity	Release velocity (0 to 127).
+ \param Channel		The channel on which the message will be sent (1 to 16).
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendNoteOff(byte NoteNumber,
+							 byte Velocity,
+							 byte Channel)
+{
+	
+	send(NoteOff,NoteNumber,Velocity,Channel);
+
+}
+
+
+/*! \brief Send a Program Change message 
+ \param ProgramNumber	The Program to select (0 to 127).
+ \param Channel			The channel on which the message will be sent (1 to 16).
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendProgramChange(byte ProgramNumber,
+								   byte Channel)
+{
+	
+	send(ProgramChange,ProgramNumber,0,Channel);
+
+}
+
+
+/*! \brief Send a Control Change message 
+ \param ControlNumber	The controller number (0 to 127). See the detailed description here: http://www.somascape.org/midi/tech/spec.html#ctrlnums
+ \param ControlValue	The value for the specified controller (0 to 127).
+ \param Channel			The channel on which the message will be sent (1 to 16). 
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendControlChange(byte ControlNumber,
+								   byte ControlValue,
+								   byte Channel)
+{
+	
+	send(ControlChange,ControlNumber,ControlValue,Channel);
+
+}
+
+
+/*! \brief Send a Polyphonic AfterTouch message (applies to only one specified note)
+ \param NoteNumber		The note to apply AfterTouch to (0 to 127).
+ \param Pressure		The amount of AfterTouch to apply (0 to 127).
+ \param Channel			The channel on which the message will be sent (1 to 16). 
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendPolyPressure(byte NoteNumber,
+								  byte Pressure,
+								  byte Channel)
+{
+	
+	send(AfterTouchPoly,NoteNumber,Pressure,Channel);
+
+}
+
+
+/*! \brief Send a MonoPhonic AfterTouch message (applies to all notes)
+ \param Pressure		The amount of AfterTouch to apply to all notes.
+ \param Channel			The channel on which the message will be sent (1 to 16). 
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendAfterTouch(byte Pressure,
+								byte Channel)
+{
+	
+	send(AfterTouchChannel,Pressure,0,Channel);
+
+}
+
+
+/*! \brief Send a Pitch Bend message using a signed integer value.
+ \param PitchValue	The amount of bend to send (in a signed integer format), between -8192 (maximum downwards bend) and 8191 (max upwards bend), center value is 0.
+ \param Channel		The channel on which the message will be sent (1 to 16).
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendPitchBend(int PitchValue,
+							   byte Channel)
+{
+	
+	unsigned int bend = PitchValue + 8192;
+	sendPitchBend(bend,Channel);
+	
+}
+
+
+/*! \brief Send a Pitch Bend message using an unsigned integer value.
+ \param PitchValue	The amount of bend to send (in a signed integer format), between 0 (maximum downwards bend) and 16383 (max upwards bend), center value is 8192.
+ \param Channel		The channel on which the message will be sent (1 to 16).
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendPitchBend(unsigned int PitchValue,
+							   byte Channel)
+{
+	
+	send(PitchBend,(PitchValue & 0x7F),(PitchValue >> 7) & 0x7F,Channel);
+	
+}
+
+
+/*! \brief Send a Pitch Bend message using a floating point value.
+ \param PitchValue	The amount of bend to send (in a floating point format), between -1.0f (maximum downwards bend) and +1.0f (max upwards bend), center value is 0.0f.
+ \param Channel		The channel on which the message will be sent (1 to 16).
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendPitchBend(double PitchValue,
+							   byte Channel)
+{
+	
+	unsigned int pitchval = (PitchValue+1.f)*8192;
+	if (pitchval > 16383) pitchval = 16383;		// overflow protection
+	sendPitchBend(pitchval,Channel);
+	
+}
+
+
+/*! \brief Generate and send a System Exclusive frame.
+ \param length	The size of the array to send
+ \param array	The byte array containing the data to send
+ \param ArrayContainsBoundaries  When set to 'true', 0xF0 & 0xF7 bytes (start & stop SysEx) will NOT be sent (and therefore must be included in the array).
+ default value is set to 'false' for compatibility with previous versions of the library.
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendSysEx(int length,
+						   const byte *const array,
+						   bool ArrayContainsBoundaries)
+{
+	
+	if (ArrayContainsBoundaries == false) {
+		
+		mSerial.write(0xF0);
+		
+		for (int i=0;i<length;++i) {
+			
+			mSerial.write(array[i]);
+			
+		}
+		
+		mSerial.write(0xF7);
+		
+	}
+	else {
+		
+		for (int i=0;i<length;++i) {
+			
+			mSerial.write(array[i]);
+			
+		}
+		
+	}
+	
+	mRunningStatus_TX = InvalidType;
+	
+}
+
+
+/*! \brief Send a Tune Request message. 
+ 
+ When a MIDI unit receives this message, it should tune its oscillators (if equipped with any) 
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendTuneRequest()
+{
+	
+	sendRealTime(TuneRequest);
+
+}
+
+
+/*! \brief Send a MIDI Time Code Quarter Frame. 
+ 
+ See MIDI Specification for more information.
+ \param TypeNibble	MTC type
+ \param ValuesNibble	MTC data
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendTimeCodeQuarterFrame(byte TypeNibble, byte ValuesNibble)
+{
+	
+	byte data = ( ((TypeNibble & 0x07) << 4) | (ValuesNibble & 0x0F) );
+	sendTimeCodeQuarterFrame(data);
+	
+}
+
+
+/*! \brief Send a MIDI Time Code Quarter Frame. 
+ 
+ See MIDI Specification for more information.
+ \param data	 if you want to encode directly the nibbles in your program, you can send the byte here.
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendTimeCodeQuarterFrame(byte data)
+{
+	
+	mSerial.write((byte)TimeCodeQuarterFrame);
+	mSerial.write(data);
+
+	mRunningStatus_TX = InvalidType;
+	
+}
+
+
+/*! \brief Send a Song Position Pointer message.
+ \param Beats	The number of beats since the start of the song.
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendSongPosition(unsigned int Beats)
+{
+	
+	mSerial.write((byte)SongPosition);
+	mSerial.write(Beats & 0x7F);
+	mSerial.write((Beats >> 7) & 0x7F);
+
+	mRunningStatus_TX = InvalidType;
+	
+}
+
+
+/*! \brief Send a Song Select message */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendSongSelect(byte SongNumber)
+{
+	
+	mSerial.write((byte)SongSelect);
+	mSerial.write(SongNumber & 0x7F);
+
+	mRunningStatus_TX = InvalidType;
+	
+}
+
+
+/*! \brief Send a Real Time (one byte) message. 
+ 
+ \param Type The available Real Time types are: Start, Stop, Continue, Clock, ActiveSensing and SystemReset.
+ You can also send a Tune Request with this method.
+ @see kMIDIType
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::sendRealTime(kMIDIType Type)
+{
+	switch (Type) {
+		case TuneRequest: // Not really real-time, but one byte anyway.
+		case Clock:
+		case Start:
+		case Stop:	
+		case Continue:
+		case ActiveSensing:
+		case SystemReset:
+			mSerial.write((byte)Type);
+			break;
+		default:
+			// Invalid Real Time marker
+			break;
+	}
+	
+	// Do not cancel Running Status for real-time messages as they can be interleaved within any message.
+	// Though, TuneRequest can be sent here, and as it is a System Common message, it must reset Running Status.
+	if (Type == TuneRequest) mRunningStatus_TX = InvalidType;
+	
+}
+
+#endif // COMPILE_MIDI_OUT
+
+
+
+#if COMPILE_MIDI_IN
+
+/*! \brief Read a MIDI message from the serial port using the main input channel (see setInputChannel() for reference).
+ 
+ Returned value: true if any valid message has been stored in the structure, false if not.
+ A valid message is a message that matches the input channel. \n\n
+ If the Thru is enabled and the messages matches the filter, it is sent back on the MIDI output.
+ */
+template<class Transport, class Settings>
+bool MIDI_Class<Transport, Settings>::read()
+{
+	
+	return read(mInputChannel);
+	
+}
+
+
+/*! \brief Reading/thru-ing method, the same as read() with a given input channel to read on. */
+template<class Transport, class Settings>
+bool MIDI_Class<Transport, Settings>::read(const byte inChannel)
+{
+	
+	if (inChannel >= MIDI_CHANNEL_OFF) return false; // MIDI Input disabled.
+	
+	if (parse(inChannel) && accept(inChannel)) {
+		
+#if USE_CALLBACKS
+		launchCallback();
+#endif
+		
+		return true;
+	}
+	
+	return false;
+	
+}
+
+
+/*! \brief Read every available byte, up to a budget, and handle all the messages they complete.
+ 
+ \param inChannel	The channel to read on (see read()).
+ \param maxBytes	The most bytes to take from the serial buffer in this call, so one call cannot starve the rest of the sketch.
+ \return The number of valid messages received. With callbacks enabled each of them has been dispatched; otherwise only the last one is left in the structure.
+ */
+template<class Transport, class Settings>
+unsigned int MIDI_Class<Transport, Settings>::readBatch(const byte inChannel, unsigned int maxBytes)
+{
+	
+	if (inChannel >= MIDI_CHANNEL_OFF) return 0; // MIDI Input disabled.
+	
+	unsigned int messages = 0;
+	int bytes_available = rx_available();
+	
+	while (maxBytes > 0 && bytes_available > 0) {
+		
+		if (parse_next(inChannel)) {
+			
+#if USE_CALLBACKS
+			launchCallback();
+#endif
+			
+			messages++;
+		}
+		
+		maxBytes--;
+		if (--bytes_available == 0) bytes_available = rx_available();
+	}
+	
+	return messages;
+	
+}
+
+
+/*! \brief Batch read on the main input channel. @see readBatch(const byte, unsigned int) */
+template<class Transport, class Settings>
+unsigned int MIDI_Class<Transport, Settings>::readBatch(unsigned int maxBytes)
+{
+	
+	return readBatch(mInputChannel, maxBytes);
+	
+}
+
+
+// Private method: number of bytes waiting in the serial buffer, or 0 if it overflowed and had to be emptied.
+template<class Transport, class Settings>
+int MIDI_Class<Transport, Settings>::rx_available()
+{
+	
+	const int bytes_available = mSerial.available();
+	
+	if (check_overflow(bytes_available)) return 0;
+	
+	return bytes_available;
+	
+}
+
+
+// Private method: parse the next byte from the serial buffer. Returns true if it completed a message to accept().
+template<class Transport, class Settings>
+bool MIDI_Class<Transport, Settings>::parse_next(byte inChannel)
+{
+	
+	return parseByte(read_byte()) && accept(inChannel);
+	
+}
+
+
+// Private method: take the next byte from the transport, forwarding it at once in cut-through Thru mode.
+template<class Transport, class Settings>
+byte MIDI_Class<Transport, Settings>::read_byte()
+{
+	
+	const byte extracted = mSerial.read();
+	
+#if (COMPILE_MIDI_OUT && COMPILE_MIDI_THRU)
+	thru_byte(extracted);
+#endif
+	
+	return extracted;
+	
+}
+
+
+// Private method: filter a complete message on the input channel, passing it to the Thru if it is kept.
+template<class Transport, class Settings>
+bool MIDI_Class<Transport, Settings>::accept(byte inChannel)
+{
+	
+	if (!input_filter(inChannel)) return false;
+	
+#if (COMPILE_MIDI_OUT && COMPILE_MIDI_THRU)
+	thru_filter(inChannel);
+#endif
+	
+	return true;
+	
+}
+
+
+// Private method: MIDI parser
+template<class Transport, class Settings>
+bool MIDI_Class<Transport, Settings>::parse(byte inChannel)
+{ 
+	
+	const int bytes_available = mSerial.available();
+	
+	if (bytes_available <= 0) {
+		// No data available.
+		return false;
+	}
+	
+	if (check_overflow(bytes_available)) return false;
+	
+	if (Settings::Use1ByteParsing) return parseByte(read_byte());
+	
+	// Keep reading until the message is assembled or the buffer is empty.
+	while (mSerial.available() > 0) {
+		if (parseByte(read_byte())) return true;
+	}
+	return false;
+	
+}
+
+
+/* Private method: feed one byte to the parser state machine.
+ 
+ Returns true when the byte completes a message, which is then stored in mMessage.
+ 
+ Parsing algorithm:
+ * If there is no pending message to be recomposed, start a new one.
+ - Find type and channel (if pertinent)
+ - Single byte messages, and running status messages completed by their first data byte, are done at once.
+ * Else, add the byte to the pending message, and check validity. When the message is done, store it.
+ */
+template<class Transport, class Settings>
+bool MIDI_Class<Transport, Settings>::parseByte(const byte extracted)
+{
+	
+	// The rest of a message cut short by an overflow: see check_overflow().
+	if (mSkipDataBytes_RX > 0 && extracted < 0xF8) {
+		if (extracted < 0x80) {
+			if (mSkipDataBytes_RX != 0xFF) mSkipDataBytes_RX--;
+			mInputStats.bytesDiscarded++;
+			return false;
+		}
+		mSkipDataBytes_RX = 0;
+	}
+	
+	// Fast path for the data bytes of 3 byte channel messages under running status (controller sweeps, note streams).
+	// The status and its length are already known, so skip the type lookup and the length logic below.
+	if (Settings::UseRunningStatusFastPath && extracted < 0x80 && mRunningStatusLength_RX == 3) {
+		
+		if (mPendingMessageIndex == 0) {
+			mPendingMessage[0] = mRunningStatus_RX;
+			mPendingMessage[1] = extracted;
+			mPendingMessageExpectedLenght = 3;
+			mPendingMessageIndex = 2;
+			return false;
+		}
+		
+		if (mPendingMessageIndex == 2 && mPendingMessage[0] == mRunningStatus_RX) {
+			mPendingMessage[2] = extracted;
+			
+			mMessage.type = (kMIDIType)(mRunningStatus_RX & 0xF0);
+			mMessage.channel = (mRunningStatus_RX & 0x0F)+1;
+			mMessage.data1 = mPendingMessage[1];
+			mMessage.data2 = extracted;
+			mMessage.valid = true;
+			
+			// Running status stays as it is.
+			mPendingMessageIndex = 0;
+			mPendingMessageExpectedLenght = 0;
+			return true;
+		}
+		
+	}
+	
+	if (mPendingMessageIndex == 0) { // Start a new pending message
+		mPendingMessage[0] = extracted;
+		
+		// Check for running status first
+		switch (getTypeFromStatusByte(mRunningStatus_RX)) {
+				// Only these types allow Running Status:
+			case NoteOff:
+			case NoteOn:
+			case AfterTouchPoly:
+			case ControlChange:
+			case ProgramChange:
+			case AfterTouchChannel:
+			case PitchBend:	
+				
+				// If the status byte is not received, prepend it to the pending message
+				if (extracted < 0x80) {
+					mPendingMessage[0] = mRunningStatus_RX;
+					mPendingMessage[1] = extracted;
+					mPendingMessageIndex = 1;
+				}
+				// Else: well, we received another status byte, so the running status does not apply here.
+				// It will be updated upon completion of this message.
+				
+				break;
+				
+			default:
+				// No running status
+				break;
+		}
+		
+		
+		switch (getTypeFromStatusByte(mPendingMessage[0])) {
+				
+				// 1 byte messages
+			case Start:
+			case Continue:
+			case Stop:
+			case Clock:
+			case ActiveSensing:
+			case SystemReset:
+			case TuneRequest:
+				// Handle the message type directly here.
+				mMessage.type = getTypeFromStatusByte(mPendingMessage[0]);
+				mMessage.channel = 0;
+				mMessage.data1 = 0;
+				mMessage.data2 = 0;
+				mMessage.valid = true;
+				
+				// \fix Running Status broken when receiving Clock messages.
+				// Do not reset all input attributes, Running Status must remain unchanged.
+				//reset_input_attributes(); 
+				
+				// We still need to reset these
+				mPendingMessageIndex = 0;
+				mPendingMessageExpectedLenght = 0;
+				
+				return true;
+				break;
+				
+				// 2 bytes messages
+			case ProgramChange:
+			case AfterTouchChannel:
+			case TimeCodeQuarterFrame:
+			case SongSelect:
+				mPendingMessageExpectedLenght = 2;
+				break;
+				
+				// 3 bytes messages
+			case NoteOn:
+			case NoteOff:
+			case ControlChange:
+			case PitchBend:
+			case AfterTouchPoly:
+			case SongPosition:
+				mPendingMessageExpectedLenght = 3;
+				break;
+				
+			case SystemExclusive:
+				mPendingMessageExpectedLenght = Settings::SysExArraySize; // As the message can be any lenght between 3 and SysExArraySize bytes
+				mRunningStatus_RX = InvalidType;
+				mRunningStatusLength_RX = 0;
+				break;
+				
+			case InvalidType:
+			default:
+				// This is obviously wrong. Let's get the hell out'a here.
+				reset_input_attributes();
+				return false;
+				break;
+		}
+		
+		// Then update the index of the pending message.
+		mPendingMessageIndex++;
+		
+		// A 2 bytes message under running status is complete with its first data byte.
+		if (mPendingMessageIndex >= mPendingMessageExpectedLenght) {
+			return completeMessage();
+		}
+		
+		// Message is not complete.
+		return false;
+		
+	}
+	
+	// First, test if this is a status byte
+	if (extracted >= 0x80) {
+		
+		// Reception of status bytes in the middle of an uncompleted message
+		// are allowed only for interleaved Real Time message or EOX
+		switch (extracted) {
+			case Clock:
+			case Start:
+			case Continue:
+			case Stop:
+			case ActiveSensing:
+			case SystemReset:
+				
+				/*
+				 This is tricky. Here we will have to extract the one-byte message,
+				 pass it to the structure for being read outside the MIDI class,
+				 and recompose the message it was interleaved into.
+				 
+				 Oh, and without killing the running status.. 
+				 
+				 This is done by leaving the pending message as is, it will be completed on next calls.
+				 */
+				
+				mMessage.type = (kMIDIType)extracted;
+				mMessage.data1 = 0;
+				mMessage.data2 = 0;
+				mMessage.channel = 0;
+				mMessage.valid = true;
+				return true;
+				
+				break;
+				
+				// End of Exclusive
+			case 0xF7:
+				if (getTypeFromStatusByte(mPendingMessage[0]) == SystemExclusive) {
+					
+					// The message stays in the pending buffer, framing included: no copy.
+					// There is always room for the EOX, see the overflow check below.
+					mPendingMessage[mPendingMessageIndex] = 0xF7;
+					
+#if USE_CALLBACKS
+					if (mSystemExclusiveChunkCallback != NULL) {
+						// Streaming: hand over the tail, the message is not reported again.
+						mSystemExclusiveChunkCallback(mPendingMessage + mSysExChunkStart, mPendingMessageIndex + 1 - mSysExChunkStart, mSysExChunkStart == 0, true);
+						reset_input_attributes();
+						return false;
+					}
+#endif
+					
+					mMessage.type = SystemExclusive;
+					
+					// Get length
+					mMessage.data1 = (mPendingMessageIndex+1) & 0xFF;	
+					mMessage.data2 = (mPendingMessageIndex+1) >> 8;
+					
+					mMessage.channel = 0;
+					mMessage.valid = true;
+					
+					reset_input_attributes();
+					
+					return true;
+				}
+				else {
+					// Well well well.. error.
+					reset_input_attributes();
+					return false;
+				}
+				
+				break;
+			default:
+				// Any other status byte cuts the pending message short (as after an overflow, when the
+				// cut-through Thru has already forwarded its first bytes): drop it and start again.
+				mInputStats.messagesLost++;
+				mPendingMessageIndex = 0;
+				mPendingMessageExpectedLenght = 0;
+				return parseByte(extracted);
+				break;
+		}
+		
+	}
+	
+	
+	// Add extracted data byte to pending message
+	mPendingMessage[mPendingMessageIndex] = extracted;
+	
+#if USE_CALLBACKS
+	// Streaming SysEx: pass the buffer on before it fills, keeping the last slot for the EOX.
+	// Byte 0 stays 0xF0 so the rest of the message is still recognised as SysEx.
+	if (mSystemExclusiveChunkCallback != NULL
+		&& mPendingMessageIndex >= Settings::SysExArraySize - 2
+		&& getTypeFromStatusByte(mPendingMessage[0]) == SystemExclusive) {
+		mSystemExclusiveChunkCallback(mPendingMessage + mSysExChunkStart, mPendingMessageIndex + 1 - mSysExChunkStart, mSysExChunkStart == 0, false);
+		mSysExChunkStart = 1;
+		mPendingMessageIndex = 1;
+		return false;
+	}
+#endif
+	
+	
+	// Now we are going to check if we have reached the end of the message
+	if (mPendingMessageIndex >= (mPendingMessageExpectedLenght-1)) {
+		
+		// "FML" case: fall down here with an overflown SysEx..
+		// This means we received the last possible data byte that can fit the buffer.
+		// If this happens, try increasing SysExArraySize in the settings.
+		if (getTypeFromStatusByte(mPendingMessage[0]) == SystemExclusive) {
+			reset_input_attributes();
+			return false;
+		}
+		
+		mPendingMessageIndex++;
+		return completeMessage();
+	}
+	
+	// Then update the index of the pending message.
+	mPendingMessageIndex++;
+	
+	// Message is not complete.
+	return false;
+	
+}
+
+
+// Private method: store the assembled channel or system common message in mMessage.
+template<class Transport, class Settings>
+bool MIDI_Class<Transport, Settings>::completeMessage()
+{
+	
+	mMessage.type = getTypeFromStatusByte(mPendingMessage[0]);
+	mMessage.channel = (mPendingMessage[0] & 0x0F)+1; // Don't check if it is a Channel Message
+	
+	mMessage.data1 = mPendingMessage[1];
+	
+	// Save data2 only if applicable
+	if (mPendingMessageExpectedLenght == 3)	mMessage.data2 = mPendingMessage[2];
+	else mMessage.data2 = 0;
+	
+	// Reset local variables
+	mPendingMessageIndex = 0;
+	mPendingMessageExpectedLenght = 0;
+	
+	mMessage.valid = true;
+	
+	// Activate running status (if enabled for the received type)
+	switch (mMessage.type) {
+		case NoteOff:
+		case NoteOn:
+		case AfterTouchPoly:
+		case ControlChange:
+		case ProgramChange:
+		case AfterTouchChannel:
+		case PitchBend:	
+			// Running status enabled: store it from received message
+			mRunningStatus_RX = mPendingMessage[0];
+			mRunningStatusLength_RX = (mMessage.type == ProgramChange || mMessage.type == AfterTouchChannel) ? 2 : 3;
+			break;
+			
+		default:
+			// No running status
+			mRunningStatus_RX = InvalidType;
+			mRunningStatusLength_RX = 0;
+			break;
+	}
+	return true;
+	
+}
+
+
+/* Private method: track the receive buffer depth, and empty it if it is full.
+ 
+ A full buffer means bytes are already being lost. Rather than flush() it blindly, the bytes are
+ read out and counted, along with the messages they held, so the loss shows up in getInputStats().
+ Returns true if the buffer was emptied.
+ */
+template<class Transport, class Settings>
+bool MIDI_Class<Transport, Settings>::check_overflow(int bytes_available)
+{
+	
+	if (bytes_available > mInputStats.rxHighWater) mInputStats.rxHighWater = bytes_available;
+	
+	if (bytes_available < Settings::RxBufferSize - 1) return false;
+	
+	// If the buffer is full -> Don't Panic! Call the Vogons to destroy it.
+	mInputStats.overflows++;
+	
+	// The running status in force, data bytes per message under it, and data bytes still due for the current one.
+	byte status = mRunningStatus_RX;
+	byte data_length = 0;
+	byte data_due = 0;
+	
+	if (mPendingMessageIndex > 0) {
+		// The message being assembled is lost too.
+		mInputStats.messagesLost++;
+		status = mPendingMessage[0] < 0xF0 ? mPendingMessage[0] : (byte)InvalidType;
+		if (getTypeFromStatusByte(mPendingMessage[0]) == SystemExclusive) data_due = 0xFF;
+		else if (mPendingMessageExpectedLenght > mPendingMessageIndex) data_due = mPendingMessageExpectedLenght - mPendingMessageIndex;
+	}
+	if (mSkipDataBytes_RX > data_due) data_due = mSkipDataBytes_RX;
+	if (status != InvalidType) data_length = (getTypeFromStatusByte(status) == ProgramChange || getTypeFromStatusByte(status) == AfterTouchChannel) ? 1 : 2;
+	
+	while (mSerial.available() > 0) {
+		
+		const byte extracted = mSerial.read();
+		mInputStats.bytesDiscarded++;
+		
+		if (extracted >= 0xF8) {
+			// Real Time, complete in itself.
+			mInputStats.messagesLost++;
+		}
+		else if (extracted == 0xF7) {
+			data_due = 0;
+		}
+		else if (extracted >= 0x80) {
+			mInputStats.messagesLost++;
+			status = extracted < 0xF0 ? extracted : (byte)InvalidType;
+			switch (getTypeFromStatusByte(extracted)) {
+				case ProgramChange:
+				case AfterTouchChannel:
+					data_length = 1;
+					break;
+				case NoteOff:
+				case NoteOn:
+				case AfterTouchPoly:
+				case ControlChange:
+				case PitchBend:
+					data_length = 2;
+					break;
+				case TimeCodeQuarterFrame:
+				case SongSelect:
+					data_length = 0;
+					data_due = 1;
+					continue;
+				case SongPosition:
+					data_length = 0;
+					data_due = 2;
+					continue;
+				default:
+					// SysEx or undefined: data runs until the next status byte.
+					data_length = 0;
+					data_due = 0xFF;
+					continue;
+			}
+			data_due = data_length;
+		}
+		else if (data_due > 0) {
+			if (data_due != 0xFF) data_due--;
+		}
+		else if (data_length > 0) {
+			// Another message under running status.
+			mInputStats.messagesLost++;
+			data_due = data_length - 1;
+		}
+		
+	}
+	
+	// Whatever was pending is gone. The running status the discarded bytes left in force still
+	// holds, once the data bytes owed to their last message have gone by too.
+	reset_input_attributes();
+	if (data_length > 0) {
+		mRunningStatus_RX = status;
+		mRunningStatusLength_RX = data_length + 1;
+		
+#if (COMPILE_MIDI_OUT && COMPILE_MIDI_THRU)
+		// The cut-through Thru follows, with the status sent again ahead of the next data byte it forwards.
+		mThruStatus = status;
+		mThruPassing = thru_passes(status);
+		mRunningStatus_TX = InvalidType;
+#endif
+	}
+	mSkipDataBytes_RX = data_due;
+	
+	return true;
+	
+}
+
+
+/*! \brief Clear the counters returned by getInputStats(). */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::resetInputStats()
+{
+	
+	mInputStats.bytesDiscarded = 0;
+	mInputStats.messagesLost = 0;
+	mInputStats.overflows = 0;
+	mInputStats.rxHighWater = 0;
+	
+}
+
+
+// Private method: check if the received message is on the listened channel
+template<class Transport, class Settings>
+bool MIDI_Class<Transport, Settings>::input_filter(byte inChannel)
+{
+	
+	
+	// This method handles recognition of channel (to know if the message is destinated to the Arduino)
+	
+	
+	if (mMessage.type == InvalidType) return false;
+	
+	
+	// First, check if the received message is Channel
+	if (mMessage.type >= NoteOff && mMessage.type <= PitchBend) {
+		
+		// Then we need to know if we listen to it
+		if ((mMessage.channel == mInputChannel) || (mInputChannel == MIDI_CHANNEL_OMNI)) {
+			return true;
+			
+		}
+		else {
+			// We don't listen to this channel
+			return false;
+		}
+		
+	}
+	else {
+		
+		// System messages are always received
+		return true;
+	}
+	
+}
+
+
+// Private method: reset input attributes
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::reset_input_attributes()
+{
+	
+	mPendingMessageIndex = 0;
+	mPendingMessageExpectedLenght = 0;
+	mRunningStatus_RX = InvalidType;
+	mRunningStatusLength_RX = 0;
+	mSkipDataBytes_RX = 0;
+	mSysExChunkStart = 0;
+	
+#if (COMPILE_MIDI_OUT && COMPILE_MIDI_THRU)
+	// The cut-through Thru drops whatever the parser drops until the next status byte (after an overflow
+	// check_overflow() puts both back on the running status).
+	mThruPassing = false;
+	mThruStatus = InvalidType;
+#endif
+	
+}
+
+
+// Getters
+/*! \brief Get the last received message's type
+ 
+ Returns an enumerated type. @see kMIDIType
+ */
+template<class Transport, class Settings>
+kMIDIType MIDI_Class<Transport, Settings>::getType() const
+{
+	
+	return mMessage.type;
+
+}
+
+
+/*! \brief Get the channel of the message stored in the structure.
+ 
+ Channel range is 1 to 16. For non-channel messages, this will return 0.
+ */
+template<class Transport, class Settings>
+byte MIDI_Class<Transport, Settings>::getChannel() const
+{
+	
+	return mMessage.channel;
+
+}
+
+
+/*! \brief Get the first data byte of the last received message. */
+template<class Transport, class Settings>
+byte MIDI_Class<Transport, Settings>::getData1() const
+{
+	
+	return mMessage.data1;
+
+}
+
+
+/*! \brief Get the second data byte of the last received message. */
+template<class Transport, class Settings>
+byte MIDI_Class<Transport, Settings>::getData2() const
+{ 
+	
+	return mMessage.data2;
+
+}
+
+
+/*! \brief Get the System Exclusive byte array. 
+ 
+ The array starts with 0xF0 and ends with 0xF7. It is the parser's own buffer, not a copy,
+ so it is only valid until the next call to read() or readBatch().
+ @see getSysExArrayLength to get the array's length in bytes.
+ */
+template<class Transport, class Settings>
+const byte * MIDI_Class<Transport, Settings>::getSysExArray() const
+{ 
+	
+	// A view of the parser's buffer: valid until the next byte is parsed.
+	return mPendingMessage;
+
+}
+
+/*! \brief Get the lenght of the System Exclusive array.
+ 
+ It is coded using data1 as LSB and data2 as MSB.
+ \return The array's length, in bytes.
+ */
+template<class Transport, class Settings>
+unsigned int MIDI_Class<Transport, Settings>::getSysExArrayLength() const
+{
+	
+	unsigned int coded_size = ((unsigned int)(mMessage.data2) << 8) | mMessage.data1;
+	
+	return (coded_size > Settings::SysExArraySize) ? Settings::SysExArraySize : coded_size;
+	
+}
+
+
+/*! \brief Check if a valid message is stored in the structure. */
+template<class Transport, class Settings>
+bool MIDI_Class<Transport, Settings>::check() const
+{ 
+	
+	return mMessage.valid;
+
+}
+
+
+// Setters
+/*! \brief Set the value for the input MIDI channel 
+ \param Channel the channel value. Valid values are 1 to 16, 
+ MIDI_CHANNEL_OMNI if you want to listen to all channels, and MIDI_CHANNEL_OFF to disable MIDI input.
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::setInputChannel(const byte Channel)
+{ 
+	
+	mInputChannel = Channel;
+	
+}
+
+
+#if USE_CALLBACKS
+
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleNoteOff(void (*fptr)(byte channel, byte note, byte velocity))			{ mNoteOffCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleNoteOn(void (*fptr)(byte channel, byte note, byte velocity))			{ mNoteOnCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleAfterTouchPoly(void (*fptr)(byte channel, byte note, byte pressure))	{ mAfterTouchPolyCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleControlChange(void (*fptr)(byte channel, byte number, byte value))	{ mControlChangeCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleProgramChange(void (*fptr)(byte channel, byte number))				{ mProgramChangeCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleAfterTouchChannel(void (*fptr)(byte channel, byte pressure))			{ mAfterTouchChannelCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandlePitchBend(void (*fptr)(byte channel, int bend))						{ mPitchBendCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleSystemExclusive(void (*fptr)(byte * array, unsigned int size))		{ mSystemExclusiveCallback = fptr; }
+
+/*! \brief Stream System Exclusive messages in chunks instead of receiving them whole.
+ 
+ The callback receives consecutive pieces of each message as the buffer fills, so messages of any
+ length get through however small SysExArraySize is. Concatenated, the chunks are the
+ complete message, 0xF0 and 0xF7 included. While a chunk callback is set, SysEx messages are
+ delivered only through it.
+ \param fptr	Called with the chunk, its length, whether it is the first of its message and whether it is the last.
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::setHandleSystemExclusiveChunk(void (*fptr)(const byte * chunk, unsigned int size, bool first, bool last))
+{
+	
+	mSystemExclusiveChunkCallback = fptr;
+	reset_input_attributes();
+	
+}
+
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleTimeCodeQuarterFrame(void (*fptr)(byte data))							{ mTimeCodeQuarterFrameCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleSongPosition(void (*fptr)(unsigned int beats))						{ mSongPositionCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleSongSelect(void (*fptr)(byte songnumber))								{ mSongSelectCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleTuneRequest(void (*fptr)(void))										{ mTuneRequestCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleClock(void (*fptr)(void))												{ mClockCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleStart(void (*fptr)(void))												{ mStartCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleContinue(void (*fptr)(void))											{ mContinueCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleStop(void (*fptr)(void))												{ mStopCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleActiveSensing(void (*fptr)(void))										{ mActiveSensingCallback = fptr; }
+template<class Transport, class Settings> void MIDI_Class<Transport, Settings>::setHandleSystemReset(void (*fptr)(void))										{ mSystemResetCallback = fptr; }
+
+
+/*! \brief Detach an external function from the given type.
+ 
+ Use this method to cancel the effects of setHandle********.
+ \param Type		The type of message to unbind. When a message of this type is received, no function will be called.
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::disconnectCallbackFromType(kMIDIType Type)
+{
+	
+	switch (Type) {
+		case NoteOff:               mNoteOffCallback = NULL;                break;
+		case NoteOn:                mNoteOnCallback = NULL;                 break;
+		case AfterTouchPoly:        mAfterTouchPolyCallback = NULL;         break;
+		case ControlChange:         mControlChangeCallback = NULL;          break;
+		case ProgramChange:         mProgramChangeCallback = NULL;          break;
+		case AfterTouchChannel:     mAfterTouchChannelCallback = NULL;      break;
+		case PitchBend:             mPitchBendCallback = NULL;              break;
+		case SystemExclusive:       mSystemExclusiveCallback = NULL;        mSystemExclusiveChunkCallback = NULL;	break;
+		case TimeCodeQuarterFrame:  mTimeCodeQuarterFrameCallback = NULL;   break;
+		case SongPosition:          mSongPositionCallback = NULL;           break;
+		case SongSelect:            mSongSelectCallback = NULL;             break;
+		case TuneRequest:           mTuneRequestCallback = NULL;            break;
+		case Clock:                 mClockCallback = NULL;                  break;
+		case Start:                 mStartCallback = NULL;                  break;
+		case Continue:              mContinueCallback = NULL;               break;
+		case Stop:                  mStopCallback = NULL;                   break;
+		case ActiveSensing:         mActiveSensingCallback = NULL;          break;
+		case SystemReset:           mSystemResetCallback = NULL;            break;
+		default:
+			break;
+	}
+	
+}
+
+
+// Private - launch callback function based on received type.
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::launchCallback()
+{
+	
+	// The order is mixed to allow frequent messages to trigger their callback faster.
+	
+	switch (mMessage.type) {
+			// Notes
+		case NoteOff:				if (mNoteOffCallback != NULL)				mNoteOffCallback(mMessage.channel,mMessage.data1,mMessage.data2);	break;
+		case NoteOn:				if (mNoteOnCallback != NULL)				mNoteOnCallback(mMessage.channel,mMessage.data1,mMessage.data2);	break;
+			
+			// Real-time messages
+		case Clock:					if (mClockCallback != NULL)					mClockCallback();			break;			
+		case Start:					if (mStartCallback != NULL)					mStartCallback();			break;
+		case Continue:				if (mContinueCallback != NULL)				mContinueCallback();		break;
+		case Stop:					if (mStopCallback != NULL)					mStopCallback();			break;
+		case ActiveSensing:			if (mActiveSensingCallback != NULL)			mActiveSensingCallback();	break;
+			
+			// Continuous controllers
+		case ControlChange:			if (mControlChangeCallback != NULL)			mControlChangeCallback(mMessage.channel,mMessage.data1,mMessage.data2);	break;
+		case PitchBend:				if (mPitchBendCallback != NULL)				mPitchBendCallback(mMessage.channel,(int)((mMessage.data1 & 0x7F) | ((mMessage.data2 & 0x7F)<< 7)) - 8192);	break; // TODO: check this
+		case AfterTouchPoly:		if (mAfterTouchPolyCallback != NULL)		mAfterTouchPolyCallback(mMessage.channel,mMessage.data1,mMessage.data2);	break;
+		case AfterTouchChannel:		if (mAfterTouchChannelCallback != NULL)		mAfterTouchChannelCallback(mMessage.channel,mMessage.data1);	break;
+			
+		case ProgramChange:			if (mProgramChangeCallback != NULL)			mProgramChangeCallback(mMessage.channel,mMessage.data1);	break;
+		case SystemExclusive:		if (mSystemExclusiveCallback != NULL)		mSystemExclusiveCallback(mPendingMessage,getSysExArrayLength());	break;
+			
+			// Occasional messages
+		case TimeCodeQuarterFrame:	if (mTimeCodeQuarterFrameCallback != NULL)	mTimeCodeQuarterFrameCallback(mMessage.data1);	break;
+		case SongPosition:			if (mSongPositionCallback != NULL)			mSongPositionCallback((mMessage.data1 & 0x7F) | ((mMessage.data2 & 0x7F)<< 7));	break;
+		case SongSelect:			if (mSongSelectCallback != NULL)			mSongSelectCallback(mMessage.data1);	break;
+		case TuneRequest:			if (mTuneRequestCallback != NULL)			mTuneRequestCallback();	break;
+			
+		case SystemReset:			if (mSystemResetCallback != NULL)			mSystemResetCallback();	break;
+		case InvalidType:
+		default:
+			break;
+	}
+	
+}
+
+
+#endif // USE_CALLBACKS
+
+
+#endif // COMPILE_MIDI_IN
+
+
+
+
+#if (COMPILE_MIDI_IN && COMPILE_MIDI_OUT && COMPILE_MIDI_THRU) // Thru
+
+/*! \brief Set the filter for thru mirroring
+ \param inThruFilterMode a filter mode
+ 
+ @see kThruFilterMode
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::setThruFilterMode(kThruFilterMode inThruFilterMode)
+{ 
+	
+	mThruFilterMode = inThruFilterMode;
+	if (mThruFilterMode != Off) mThruActivated = true;
+	else mThruActivated = false;
+	
+}
+
+
+/*! \brief Forward bytes as they are read instead of whole messages.
+ 
+ In cut-through mode each byte goes to the output as soon as read() or readBatch() takes it from the input, so
+ the output lags the input by the time between two reads rather than by a whole message.
+ The filter mode is applied on status bytes: the bytes of a channel message follow their status byte (and its
+ running status) through or not. System messages always pass, Real Time ones even in the middle of a message.
+ Messages sent from the sketch should go out between messages, as they do from the handlers: a message sent
+ while a forwarded one is incomplete would split it.
+ */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::setThruCutThrough(bool inCutThrough)
+{
+	
+	mThruCutThrough = inCutThrough;
+	mThruPassing = false;
+	mThruStatus = InvalidType;
+	
+}
+
+
+/*! \brief Setter method: turn message mirroring on. */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::turnThruOn(kThruFilterMode inThruFilterMode)
+{ 
+	
+	mThruActivated = true;
+	mThruFilterMode = inThruFilterMode;
+	
+}
+
+
+/*! \brief Setter method: turn message mirroring off. */
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::turnThruOff()
+{
+	
+	mThruActivated = false; 
+	mThruFilterMode = Off;
+	
+}
+
+
+// This method is called upon reception of a message and takes care of Thru filtering and sending.
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::thru_filter(byte inChannel)
+{
+	
+	/*
+	 This method handles Soft-Thru filtering.
+	 
+	 Soft-Thru filtering:
+	 - All system messages (System Exclusive, Common and Real Time) are passed to output unless filter is set to Off
+	 - Channel messages are passed to the output whether their channel is matching the input channel and the filter setting
+	 
+	 */
+	
+	// If the feature is disabled, don't do anything. In cut-through mode the bytes have been forwarded already.
+	if (!mThruActivated || (mThruFilterMode == Off) || mThruCutThrough) return;
+	
+	
+	// First, check if the received message is Channel
+	if (mMessage.type >= NoteOff && mMessage.type <= PitchBend) {
+		
+		const bool filter_condition = ((mMessage.channel == mInputChannel) || (mInputChannel == MIDI_CHANNEL_OMNI));
+		
+		// Now let's pass it to the output
+		switch (mThruFilterMode) {
+			case Full:
+				send(mMessage.type,mMessage.data1,mMessage.data2,mMessage.channel);
+				return;
+				break;
+			case SameChannel:
+				if (filter_condition) {
+					send(mMessage.type,mMessage.data1,mMessage.data2,mMessage.channel);
+					return;
+				}
+				break;
+			case DifferentChannel:
+				if (!filter_condition) {
+					send(mMessage.type,mMessage.data1,mMessage.data2,mMessage.channel);
+					return;
+				}
+				break;
+			case Off:
+				// Do nothing. 
+				// Technically it's impossible to get there because the case was already tested earlier.
+				break;
+			default:
+				break;
+		}
+		
+	}
+	else {
+		
+		// Send the message to the output
+		switch (mMessage.type) {
+				// Real Time and 1 byte
+			case Clock:
+			case Start:
+			case Stop:
+			case Continue:
+			case ActiveSensing:
+			case SystemReset:
+			case TuneRequest:	
+				sendRealTime(mMessage.type);
+				return;
+				break;
+				
+			case SystemExclusive:
+				// Send SysEx (0xF0 and 0xF7 are included in the buffer)
+				sendSysEx(getSysExArrayLength(),getSysExArray(),true); 
+				return;
+				break;
+				
+			case SongSelect:
+				sendSongSelect(mMessage.data1);
+				return;
+				break;
+				
+			case SongPosition:
+				sendSongPosition(mMessage.data1 | ((unsigned)mMessage.data2<<7));
+				return;
+				break;
+				
+			case TimeCodeQuarterFrame:
+				sendTimeCodeQuarterFrame(mMessage.data1,mMessage.data2);
+				return;
+				break;
+			default:
+				break;
+				
+		}
+		
+	}
+	
+}
+
+
+// Private method: whether the filter lets the channel messages with this status byte through.
+template<class Transport, class Settings>
+bool MIDI_Class<Transport, Settings>::thru_passes(byte inStatus)
+{
+	
+	const byte channel = (inStatus & 0x0F)+1;
+	const bool filter_condition = ((channel == mInputChannel) || (mInputChannel == MIDI_CHANNEL_OMNI));
+	
+	return (mThruFilterMode == Full
+			|| (mThruFilterMode == SameChannel && filter_condition)
+			|| (mThruFilterMode == DifferentChannel && !filter_condition));
+	
+}
+
+
+// This method is called with each byte read in cut-through mode and forwards it if its message passes the filter.
+template<class Transport, class Settings>
+void MIDI_Class<Transport, Settings>::thru_byte(byte extracted)
+{
+	
+	if (!mThruActivated || (mThruFilterMode == Off) || !mThruCutThrough) return;
+	
+	// Real Time: can be interleaved anywhere, always passes.
+	if (extracted >= 0xF8) {
+		mSerial.write(extracted);
+		return;
+	}
+	
+	if (extracted >= 0x80) {
+		
+		if (extracted < 0xF0) {
+			// Channel message: the status byte decides for the whole message and its running status.
+			mThruPassing = thru_passes(extracted);
+			mThruStatus = extracted;
+			if (mThruPassing) mRunningStatus_TX = extracted;
+		}
+		else {
+			// System Exclusive and System Common: they pass, and cancel running status.
+			mThruPassing = true;
+			mThruStatus = InvalidType;
+			mRunningStatus_TX = InvalidType;
+		}
+		
+		if (mThruPassing) mSerial.write(extracted);
+		return;
+	}
+	
+	// The rest of a message cut short by an overflow is not forwarded either.
+	if (!mThruPassing || mSkipDataBytes_RX > 0) return;
+	
+	// A data byte starting a message under running status. If something else was sent since the
+	// last forwarded status, the receiver has lost that running status: send the status again.
+	if (mPendingMessageIndex == 0 && mThruStatus != InvalidType && mRunningStatus_TX != mThruStatus) {
+		mSerial.write(mThruStatus);
+		mRunningStatus_TX = mThruStatus;
+	}
+	
+	mSerial.write(extracted);
+	
+}
+
+
+#endif // Thru
+
+
@@ -0,0 +1,81 @@
+#include <inttypes.h>
+#include <avr/pgmspace.h>
+#include "patch.h"
+#include "bank.h"
+#include "userbank.h"
+#include "factory.h"
+
+// A sound in the factory bank: a patch's name and packed values, 25 bytes.
+struct factorySound {
+    char name[PATCHNAME_LEN];
+    uint8_t values[PATCH_VALUES_LEN];
+};
+
+// One sound from factory.h, packed.
+#define FACTORY_SOUND(name, v0, v1, v2, v3, v4, v5, v6, \
+        v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, \
+        v23, v24, v25, v26) \
+    {name, PATCH_VALUES(v0, v1, v2, v3, v4, v5, v6, \
+        v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, \
+        v23, v24, v25, v26)},
+
+static const factorySound factorySounds[] PROGMEM = {
+    FACTORY_BANK(FACTORY_SOUND)
+};
+
+#define FACTORY_SOUNDS (sizeof(factorySounds) / sizeof(factorySounds[0]))
+#define INIT (FACTORY_SOUNDS - 1)
+
+// The sound each program number plays.
+static const uint8_t factoryPrograms[PATCH_BANK_LEN] PROGMEM = {
+    0, 1, 2, 3, 4, 5, 6, 7,
+    8, 9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+    INIT, INIT, INIT, INIT, INIT, INIT, INIT, INIT,
+};
+
+static const factorySound *factoryProgram(uint8_t program) {
+    return &factorySounds[pgm_read_byte(&factoryPrograms[program])];
+}
+
+bool loadFactoryPatch(uint8_t program, patchSettings *pDest) {
+    if (program >= PATCH_BANK_LEN) return false;
+    const factorySound *s = factoryProgram(program);
+    memcpy_P(pDest->values, s->values, PATCH_VALUES_LEN);
+    memcpy_P(pDest->name, s->name, PATCHNAME_LEN);
+    pDest->id = program;
+    return true;
+}
+
+const char *patchName(patchNamePage *pPage, const userBank *pUser, uint8_t program) {
+    if (program >= PATCH_BANK_LEN) return NULL;
+    uint8_t i = program - pPage->first;
+    if (program < pPage->first || i >= pPage->count) {
+        pPage->first = program - program % PATCH_NAME_PAGE;
+        for (i = 0; i < PATCH_NAME_PAGE; i++) {
+            if (loadUserPatchName(pUser, pPage->first + i, pPage->names[i])) continue;
+            memcpy_P(pPage->names[i], factoryProgram(pPage->first + i)->name, PATCHNAME_LEN);
+        }
+        pPage->count = PATCH_NAME_PAGE;
+        i = program - pPage->first;
+    }
+    return pPage->names[i];
+}
+
+void forgetPatchNames(patchNamePage *pPage) {
+    pPage->count = 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * The patch bank: what each MIDI program number loads.
+ *
+ * The factory bank lives in flash as packed patches (the sounds in
+ * factory.h, packed by PATCH_VALUES in patch.h), one table of sounds and one
+ * byte per program number saying which of them it plays, so a program is
+ * found by indexing, whatever its number, and copied straight into the patch
+ * that will play it. Program numbers the
+ * factory sounds don't fill play an initial patch.
+ *
+ * The patch browser only wants names, so it reads them a page at a time into
+ * a patchNamePage: scrolling through a page costs nothing, and moving to
+ * another reads that page's names and nothing else of the patches.
+ */
+#ifndef BANK_H_
+#define BANK_H_
+
+#include <inttypes.h>
+
+struct patchSettings;
+struct userBank;
+
+#define PATCH_BANK_LEN 128 // Program numbers, 0 - 127.
+#define PATCH_NAME_PAGE 8  // Names a page holds. Must divide PATCH_BANK_LEN.
+
+// The names of a run of consecutive programs.
+struct patchNamePage {
+    uint8_t first;      // Program number of names[0].
+    uint8_t count;      // Names held, 0 until a page is read.
+    char names[PATCH_NAME_PAGE][PATCHNAME_LEN];
+};
+
+// Copy factory program `program` into `pDest`. False if there is no such
+// program.
+bool loadFactoryPatch(uint8_t program, patchSettings *pDest);
+
+// The name of program `program`, the user patch's if there is one, reading
+// the page it is on if `pPage` holds another, so good until the next call.
+// NULL if there is no such program.
+const char *patchName(patchNamePage *pPage, const userBank *pUser, uint8_t program);
+
+// Have the next patchName() read its page again, e.g. after a patch is saved.
+void forgetPatchNames(patchNamePage *pPage);
+
+#endif // BANK_H_
@@ -0,0 +1,31 @@
+#include "event.h"
+
+// Keep the compiler from moving the slot copy past the index update.
+#define barrier() __asm__ __volatile__("" ::: "memory")
+
+uint8_t eventCount(const eventQueue *q) {
+    return (uint8_t)(q->head - q->tail);
+}
+
+bool pushEvent(eventQueue *q, const midiEvent *pEvent) {
+    uint8_t head = q->head;
+    uint8_t count = (uint8_t)(head - q->tail);
+    if (count >= EVENT_QUEUE_LEN) {
+        q->dropped++;
+        return false;
+    }
+    q->events[head & (EVENT_QUEUE_LEN - 1)] = *pEvent;
+    barrier();
+    q->head = head + 1;
+    if (count + 1 > q->highWater) q->highWater = count + 1;
+    return true;
+}
+
+bool popEvent(eventQueue *q, midiEvent *pEvent) {
+    uint8_t tail = q->tail;
+    if (tail == q->head) return false;
+    *pEvent = q->events[tail & (EVENT_QUEUE_LEN - 1)];
+    barrier();
+    q->tail = tail + 1;
+    return true;
+}
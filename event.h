@@ -0,0 +1,39 @@
+/*
+ * A queue of timestamped MIDI events, from the MIDI callbacks to the engine.
+ *
+ * Single producer, single consumer and allocation free. Each side only
+ * writes its own index and the indices are single bytes, so neither side has
+ * to disable interrupts even if the producer is moved into an ISR.
+ */
+#ifndef EVENT_H_
+#define EVENT_H_
+
+#include <inttypes.h>
+
+#define EVENT_QUEUE_LEN 16 // Must be a power of two, at most 128.
+
+struct midiEvent {
+    uint8_t type;       // kMIDIType
+    uint8_t channel;
+    uint8_t data1;
+    uint8_t data2;
+    unsigned long time; // micros() when the message was parsed.
+};
+
+struct eventQueue {
+    midiEvent events[EVENT_QUEUE_LEN];
+    volatile uint8_t head;  // Next slot to fill, written by the producer.
+    volatile uint8_t tail;  // Next slot to drain, written by the consumer.
+    volatile uint16_t dropped;  // Events lost because the queue was full.
+    uint8_t highWater;      // Deepest the queue has been.
+};
+
+// Producer side. Returns false, and counts a drop, if the queue is full.
+bool pushEvent(eventQueue *q, const midiEvent *pEvent);
+
+// Consumer side. Returns false if the queue is empty.
+bool popEvent(eventQueue *q, midiEvent *pEvent);
+
+uint8_t eventCount(const eventQueue *q);
+
+#endif // EVENT_H_
@@ -0,0 +1,117 @@
+/*
+ * The factory sounds. FACTORY_BANK(SOUND) calls SOUND(name, ...) for each,
+ * with its 27 parameter values in id order, as PATCH_VALUES (patch.h) takes
+ * them: bank.cpp packs them into flash, and host/patchcheck checks that they
+ * unpack to the values given here. The last is the initial patch.
+ */
+#ifndef FACTORY_H_
+#define FACTORY_H_
+
+#define FACTORY_BANK(SOUND) \
+    SOUND("Bleep", \
+        0, 0, 8, 0, 8, 2, 1, \
+        0, 0, 8, 0, 8, 2, 1, 0, \
+        0, 0, 8, 0, 8, 2, 1, 0, \
+        200, 0, 1, 0) \
+    SOUND("Spacey", \
+        2, 2048, 12, 12, 15, 0, 1, \
+        2, 2048, 12, 12, 15, 0, 1, 0, \
+        2, 2048, 12, 12, 15, 0, 1, 0, \
+        2000, 8, 0, 0) \
+    SOUND("Belong", \
+        1, 0, 1, 1, 4, 1, 1, \
+        2, 2048, 2, 4, 4, 2, 1, 0, \
+        3, 0, 3, 4, 4, 3, 1, 0, \
+        2047, 0, 0, 4) \
+    SOUND("Disaste", \
+        2, 2048, 0, 8, 0, 0, 1, \
+        2, 2048, 0, 8, 0, 0, 1, 0, \
+        2, 2048, 0, 8, 0, 0, 1, 0, \
+        1024, 0, 0, 0) \
+    SOUND("Sawbass", \
+        1, 0, 0, 15, 14, 5, 1, \
+        1, 0, 0, 15, 14, 5, 1, 4, \
+        1, 0, 0, 15, 14, 5, 1, 8, \
+        1024, 4, 0, 0) \
+    SOUND("Bowser", \
+        4, 0, 8, 0, 14, 2, 1, \
+        0, 0, 8, 0, 14, 2, 1, 0, \
+        0, 0, 0, 0, 0, 0, 1, 50, \
+        200, 4, 1, 0) \
+    SOUND("syncpad", \
+        2, 500,  12, 7, 0, 12, 1, \
+        6, 1000, 12, 8, 0, 12, 1, 10, \
+        6, 2000, 12, 9, 0, 12, 1, 20, \
+        2000, 1, 0, 0) \
+    SOUND("digi", \
+        7, 0, 1, 2, 10, 5, 1, \
+        0, 0, 1, 4, 12, 5, 1, 0, \
+        0, 0, 5, 4, 15, 8, 0, 50, \
+        1320, 2, 3, 0) \
+    SOUND("modmod", \
+        0, 0, 3, 10, 5, 5, 1, \
+        3, 0, 3, 10, 5, 5, 1, 1, \
+        0, 0, 0, 0, 0, 0, 1, 50, \
+        2000, 2, 0, 0) \
+    SOUND("sings", \
+        0, 0, 3, 3, 9, 6, 1, \
+        4, 0, 3, 3, 9, 6, 1, 10, \
+        0, 0, 0, 5, 3, 6, 1, 2, \
+        2000, 2, 0, 0) \
+    SOUND("pluky", \
+        1, 0, 3, 3, 9, 6, 1, \
+        5, 0, 3, 3, 9, 6, 1, 10, \
+        5, 0, 0, 5, 3, 6, 1, 40, \
+        700, 3, 1, 0) \
+    SOUND("boomer", \
+        7, 0, 0, 3, 0, 0, 1, \
+        3, 0, 1, 2, 13, 4, 1, 10, \
+        3, 0, 1, 2, 13, 4, 1, 20, \
+        1400, 2, 2, 0) \
+    SOUND("metalsc", \
+        7, 0, 0, 3, 0, 0, 1, \
+        7, 0, 1, 2, 13, 4, 1, 5, \
+        3, 0, 1, 2, 13, 4, 1, 1, \
+        1400, 2, 1, 0) \
+    SOUND("slider", \
+        0, 0, 1, 4, 13, 4, 1, \
+        4, 0, 1, 4, 13, 6, 1, 60, \
+        0, 0, 5, 2, 13, 4, 1, 2, \
+        2000, 2, 0, 0) \
+    SOUND("lowrm", \
+        0, 0, 4, 0, 15, 3, 1, \
+        5, 0, 0, 3, 10, 0, 1, 10, \
+        5, 0, 0, 3, 10, 0, 1, 8, \
+        2000, 4, 0, 0) \
+    SOUND("nring", \
+        0, 0, 4, 4, 12, 3, 0, \
+        7, 0, 0, 0, 0, 0, 1, 0, \
+        3, 0, 2, 4, 11, 0, 1, 2, \
+        2000, 4, 0, 0) \
+    SOUND("tin", \
+        0, 0, 1, 4, 12, 3, 0, \
+        4, 0, 1, 4, 12, 0, 0, 5, \
+        7, 0, 0, 4, 0, 0, 1, 0, \
+        2000, 4, 2, 0) \
+    SOUND("pcomplx", \
+        2, 1400, 1, 4, 12, 3, 1, \
+        2, 300,  1, 4, 12, 3, 1, 2, \
+        3, 0,    0, 4, 10, 8, 0, 0, \
+        2000, 0, 0, 0) \
+    SOUND("rounds", \
+        3, 0,    1, 4, 8, 3, 1, \
+        2, 1000, 1, 4, 8, 3, 1, 0, \
+        3, 0,    1, 4, 8, 3, 0, 10, \
+        2000, 0, 0, 0) \
+    SOUND("fff", \
+        0, 0, 4, 4, 8, 6, 0, \
+        4, 0, 4, 4, 8, 6, 0, 2, \
+        4, 0, 3, 4, 8, 3, 0, 64, \
+        2000, 0, 1, 0) \
+    SOUND("Init", \
+        1, 2048, 0, 0, 15, 4, 0, \
+        1, 2048, 0, 0, 15, 4, 0, 0, \
+        1, 2048, 0, 0, 15, 4, 0, 0, \
+        2047, 0, 0, 0)
+
+#endif // FACTORY_H_
@@ -0,0 +1,64 @@
+/*
+ * Host stand-in for the Arduino core.
+ *
+ * Just enough of Arduino v1.0.1 for the sketch and the MIDI library to build
+ * natively. Pins are an in-memory array, time comes from the host's
+ * monotonic clock and `Serial` reads from a pluggable byte transport (see
+ * HardwareSerial.h).
+ */
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+// Uno analogue pins, used as digital I/O by the sketch.
+#define NUM_DIGITAL_PINS 20
+const static uint8_t A0 = 14;
+const static uint8_t A1 = 15;
+const static uint8_t A2 = 16;
+const static uint8_t A3 = 17;
+const static uint8_t A4 = 18;
+const static uint8_t A5 = 19;
+
+typedef bool boolean;
+typedef uint8_t byte;
+// On the AVR `unsigned int` is 16 bits, and MIDI.h relies on that.
+typedef uint16_t word;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void interrupts(void);
+void noInterrupts(void);
+
+#include "HardwareSerial.h"
+
+#endif // HOST_ARDUINO_H_
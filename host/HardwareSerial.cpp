@@ -0,0 +1,154 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Arduino.h"
+#include "HardwareSerial.h"
+
+HardwareSerial Serial;
+
+// FdTransport
+
+FdTransport::FdTransport(int inFd, int outFd, bool isPty)
+    : mInFd(inFd), mOutFd(outFd), mIsPty(isPty), mIsFile(false) {
+    int flags = fcntl(mInFd, F_GETFL);
+    if (flags != -1) fcntl(mInFd, F_SETFL, flags | O_NONBLOCK);
+    struct stat st;
+    if (fstat(mInFd, &st) == 0) mIsFile = S_ISREG(st.st_mode);
+}
+
+FdTransport::~FdTransport() {
+    if (mInFd > STDERR_FILENO) close(mInFd);
+}
+
+FdTransport *FdTransport::open(const char *path) {
+    if (strcmp(path, "-") == 0) return new FdTransport(STDIN_FILENO);
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    return new FdTransport(fd);
+}
+
+FdTransport *FdTransport::openPty(char *slaveName, size_t len) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0) return NULL;
+    if (grantpt(fd) != 0 || unlockpt(fd) != 0 || ptsname_r(fd, slaveName, len) != 0) {
+        close(fd);
+        return NULL;
+    }
+    return new FdTransport(fd, -1, true);
+}
+
+int FdTransport::receive(uint8_t *buf, int len) {
+    ssize_t n = ::read(mInFd, buf, len);
+    if (n > 0) return n;
+    if (n == 0) return mIsPty ? 0 : -1;
+    // A pty master reports EIO while no one has the slave open.
+    if (errno == EAGAIN || errno == EINTR || (mIsPty && errno == EIO)) return 0;
+    return -1;
+}
+
+void FdTransport::transmit(uint8_t b) {
+    if (mOutFd >= 0 && ::write(mOutFd, &b, 1) != 1) mOutFd = -1;
+}
+
+// HardwareSerial
+
+HardwareSerial::HardwareSerial()
+    : mTransport(NULL), mPaced(true), mEof(false), mByteTime(0), mLastArrival(0),
+      mStageLen(0), mStagePos(0), mStageSeen(0), mHead(0), mTail(0),
+      mReceived(0), mOverruns(0) {
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+    // 8N1: a start bit, eight data bits and a stop bit per byte.
+    mByteTime = baud ? 10000000UL / baud : 0;
+    mHead = mTail = 0;
+}
+
+void HardwareSerial::end() {
+    mHead = mTail = 0;
+}
+
+void HardwareSerial::attach(HostTransport *pTransport) {
+    mTransport = pTransport;
+    mEof = (pTransport == NULL);
+    mStageLen = mStagePos = 0;
+    mLastArrival = 0;
+}
+
+// Move bytes that have "arrived" by now from the transport into the ring.
+void HardwareSerial::poll() {
+    if (mTransport == NULL) return;
+    unsigned long now = micros();
+
+    for (;;) {
+        if (mStagePos == mStageLen) {
+            if (mEof) return;
+            int n = mTransport->receive(mStage, sizeof(mStage));
+            if (n < 0) mEof = true;
+            if (n <= 0) return;
+            mStageLen = n;
+            mStagePos = 0;
+            // A continuous source had these bytes waiting all along: they
+            // follow the previous ones on the wire, even if the sketch is
+            // only looking now.
+            if (mPaced && mTransport->continuous() && mLastArrival != 0) mStageSeen = mLastArrival;
+            else mStageSeen = now;
+        }
+
+        unsigned long due = mStageSeen;
+        if (mPaced && mLastArrival + mByteTime > due) due = mLastArrival + mByteTime;
+        if (due > now) return;
+
+        unsigned int next = (mHead + 1) % SERIAL_BUFFER_SIZE;
+        if (!mPaced && (SERIAL_BUFFER_SIZE + mHead - mTail) % SERIAL_BUFFER_SIZE >= SERIAL_BUFFER_SIZE / 2) {
+            // Unpaced input waits for room instead, topping the ring up to
+            // half full so it never looks like an overflow to the sketch.
+            return;
+        }
+        if (next == mTail) {
+            mOverruns++;
+        }
+        else {
+            mRing[mHead] = mStage[mStagePos];
+            mHead = next;
+            mReceived++;
+        }
+        mStagePos++;
+        mLastArrival = due;
+    }
+}
+
+int HardwareSerial::available(void) {
+    poll();
+    return (SERIAL_BUFFER_SIZE + mHead - mTail) % SERIAL_BUFFER_SIZE;
+}
+
+int HardwareSerial::peek(void) {
+    if (mHead == mTail) return -1;
+    return mRing[mTail];
+}
+
+int HardwareSerial::read(void) {
+    if (mHead == mTail) return -1;
+    uint8_t c = mRing[mTail];
+    mTail = (mTail + 1) % SERIAL_BUFFER_SIZE;
+    return c;
+}
+
+void HardwareSerial::flush(void) {
+    mTail = mHead;
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+    if (mTransport) mTransport->transmit(b);
+    return 1;
+}
+
+bool HardwareSerial::exhausted() {
+    poll();
+    return mEof && mStagePos == mStageLen && mHead == mTail;
+}
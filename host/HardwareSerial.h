@@ -0,0 +1,118 @@
+/*
+ * Host stand-in for the Arduino HardwareSerial class.
+ *
+ * The AVR core fills a ring buffer from the USART receive interrupt. Here the
+ * ring is filled from a HostTransport whenever the sketch looks at the port,
+ * either as fast as the sketch reads it (unpaced, keeping the ring at most
+ * half full) or no faster than the configured baud rate allows (paced, the
+ * default). Paced input that finds
+ * the ring full is dropped, just as the USART interrupt would drop it.
+ */
+#ifndef HOST_HARDWARESERIAL_H_
+#define HOST_HARDWARESERIAL_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// The MIDI library assumes a 128 byte receive buffer. Like the AVR core the
+// ring keeps one slot free, so at most SERIAL_BUFFER_SIZE - 1 bytes are
+// ever available.
+#define SERIAL_BUFFER_SIZE 128
+
+// A source (and optionally a sink) of raw bytes for a serial port.
+class HostTransport {
+public:
+    virtual ~HostTransport() {}
+
+    // Copy up to `len` pending bytes into `buf`. Returns the number of bytes
+    // copied, 0 if nothing is pending right now or -1 once the source is
+    // exhausted for good.
+    virtual int receive(uint8_t *buf, int len) = 0;
+
+    // Bytes written by the sketch. Discarded unless overridden.
+    virtual void transmit(uint8_t) {}
+
+    // True if the source never makes the wire wait, like a regular file:
+    // paced bytes then follow each other back to back however late the
+    // sketch looks at the port. Otherwise bytes go on the wire no earlier
+    // than they are received.
+    virtual bool continuous() const { return false; }
+};
+
+// Transport over file descriptors: a regular file, a pipe, stdin or the
+// master side of a pseudo terminal.
+class FdTransport : public HostTransport {
+public:
+    FdTransport(int inFd, int outFd = -1, bool isPty = false);
+    ~FdTransport();
+
+    // Open `path` for reading, "-" being stdin. Returns NULL on failure.
+    static FdTransport *open(const char *path);
+
+    // Create a pseudo terminal and read from its master side. The slave
+    // device path is copied to `slaveName`. Returns NULL on failure.
+    static FdTransport *openPty(char *slaveName, size_t len);
+
+    // Send transmitted bytes to `fd` (-1 to discard them).
+    void setOutput(int fd) { mOutFd = fd; }
+
+    int receive(uint8_t *buf, int len);
+    void transmit(uint8_t b);
+    bool continuous() const { return mIsFile; }
+
+private:
+    int mInFd;
+    int mOutFd;
+    bool mIsPty;
+    bool mIsFile;
+};
+
+class HardwareSerial {
+public:
+    HardwareSerial();
+
+    void begin(unsigned long baud);
+    void end();
+    int available(void);
+    int peek(void);
+    int read(void);
+    // Pre-1.0 semantics: discard everything in the receive buffer. This is
+    // what the MIDI library expects when it calls flush().
+    void flush(void);
+    size_t write(uint8_t b);
+
+    // Host only.
+    void attach(HostTransport *pTransport);
+    void setPaced(bool paced) { mPaced = paced; }
+
+    // True once the transport is exhausted and every byte has been read.
+    bool exhausted();
+
+    unsigned long received() const { return mReceived; }
+    unsigned long overruns() const { return mOverruns; }
+
+private:
+    void poll();
+
+    HostTransport *mTransport;
+    bool mPaced;
+    bool mEof;
+    unsigned long mByteTime;    // Microseconds per byte on the wire.
+    unsigned long mLastArrival; // When the previous byte came off the wire.
+
+    uint8_t mStage[256];        // Read from the transport, not yet arrived.
+    int mStageLen;
+    int mStagePos;
+    unsigned long mStageSeen;   // When the staged bytes were read.
+
+    uint8_t mRing[SERIAL_BUFFER_SIZE];
+    unsigned int mHead;
+    unsigned int mTail;
+
+    unsigned long mReceived;
+    unsigned long mOverruns;
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOST_HARDWARESERIAL_H_
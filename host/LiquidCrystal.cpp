@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <string.h>
+#include "LiquidCrystal.h"
+
+bool LiquidCrystal::sEcho = false;
+
+LiquidCrystal::LiquidCrystal(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t)
+    : mCols(16), mRows(2), mCol(0), mRow(0), mDirty(false) {
+    memset(mScreen, 0, sizeof(mScreen));
+}
+
+void LiquidCrystal::begin(uint8_t cols, uint8_t rows) {
+    mCols = cols > 40 ? 40 : cols;
+    mRows = rows > 4 ? 4 : rows;
+    clear();
+}
+
+void LiquidCrystal::show() {
+    if (!sEcho || !mDirty) return;
+    fprintf(stderr, "+%.*s+\n", mCols, "----------------------------------------");
+    for (int r = 0; r < mRows; r++) {
+        fprintf(stderr, "|");
+        for (int c = 0; c < mCols; c++) {
+            char ch = mScreen[r][c];
+            fputc(ch >= ' ' && ch < 127 ? ch : ' ', stderr);
+        }
+        fprintf(stderr, "|\n");
+    }
+    mDirty = false;
+}
+
+void LiquidCrystal::clear() {
+    show();
+    memset(mScreen, 0, sizeof(mScreen));
+    mCol = mRow = 0;
+}
+
+void LiquidCrystal::home() { mCol = mRow = 0; }
+
+void LiquidCrystal::setCursor(uint8_t col, uint8_t row) {
+    mCol = col;
+    mRow = row < mRows ? row : mRows - 1;
+}
+
+void LiquidCrystal::blink() {}
+void LiquidCrystal::noBlink() {}
+void LiquidCrystal::cursor() {}
+void LiquidCrystal::noCursor() {}
+
+size_t LiquidCrystal::write(uint8_t c) {
+    if (mCol < mCols) mScreen[mRow][mCol] = c;
+    mCol++;
+    mDirty = true;
+    return 1;
+}
+
+size_t LiquidCrystal::print(const char *str) {
+    size_t n = 0;
+    while (str[n]) write(str[n++]);
+    return n;
+}
+
+size_t LiquidCrystal::print(char c) { return write(c); }
+
+size_t LiquidCrystal::print(unsigned long n, int base) {
+    char buf[33];
+    snprintf(buf, sizeof(buf), base == HEX ? "%lX" : "%lu", n);
+    return print((const char *)buf);
+}
+
+size_t LiquidCrystal::print(long n, int base) {
+    if (n < 0 && base == DEC) return write('-') + print((unsigned long)-n, base);
+    return print((unsigned long)n, base);
+}
+
+size_t LiquidCrystal::print(unsigned char n, int base) { return print((unsigned long)n, base); }
+size_t LiquidCrystal::print(int n, int base) { return print((long)n, base); }
+size_t LiquidCrystal::print(unsigned int n, int base) { return print((unsigned long)n, base); }
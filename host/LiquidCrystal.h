@@ -0,0 +1,55 @@
+/*
+ * Host stand-in for the LiquidCrystal library.
+ *
+ * Keeps a character buffer the size of the display. When echo is enabled the
+ * screen is printed to stderr each time clear() starts a new frame.
+ */
+#ifndef HOST_LIQUIDCRYSTAL_H_
+#define HOST_LIQUIDCRYSTAL_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#define DEC 10
+#define HEX 16
+
+class LiquidCrystal {
+public:
+    LiquidCrystal(uint8_t rs, uint8_t enable,
+                  uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+
+    void begin(uint8_t cols, uint8_t rows);
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    void blink();
+    void noBlink();
+    void cursor();
+    void noCursor();
+
+    size_t write(uint8_t c);
+    size_t print(const char *str);
+    size_t print(char c);
+    size_t print(unsigned char n, int base = DEC);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+
+    // Host only.
+    static void setEcho(bool echo) { sEcho = echo; }
+    const char *line(uint8_t row) const { return mScreen[row]; }
+
+private:
+    void show();
+
+    static bool sEcho;
+    uint8_t mCols;
+    uint8_t mRows;
+    uint8_t mCol;
+    uint8_t mRow;
+    bool mDirty;
+    char mScreen[4][41];
+};
+
+#endif // HOST_LIQUIDCRYSTAL_H_
@@ -0,0 +1,61 @@
+/*
+ * A MIDI_Class transport backed by a plain ring buffer, for host tools that
+ * feed the parser directly. Nothing here touches HardwareSerial, so a tool
+ * using it needs none of the Arduino stand-ins.
+ *
+ *     RingTransport<> port;
+ *     MIDI_Class<RingTransport<> > midi(port);
+ *     port.push(0x90); port.push(60); port.push(100);
+ *     midi.read();
+ */
+#ifndef HOST_RINGTRANSPORT_H_
+#define HOST_RINGTRANSPORT_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// Size must be a power of two. As on the AVR one slot is kept free, so at
+// most Size - 1 bytes are available.
+template<unsigned int Size = 128>
+class RingTransport {
+public:
+    RingTransport() : mHead(0), mTail(0), mDropped(0), mWritten(0) {}
+
+    void begin(long) { mHead = mTail = 0; }
+    int available() const { return (mHead - mTail) & (Size - 1); }
+    int read() {
+        if (mHead == mTail) return -1;
+        uint8_t c = mRing[mTail];
+        mTail = (mTail + 1) & (Size - 1);
+        return c;
+    }
+    size_t write(uint8_t) { mWritten++; return 1; }
+
+    // Host side: queue a received byte. Returns false, counting the byte as
+    // dropped, if the ring is full.
+    bool push(uint8_t b) {
+        unsigned int next = (mHead + 1) & (Size - 1);
+        if (next == mTail) {
+            mDropped++;
+            return false;
+        }
+        mRing[mHead] = b;
+        mHead = next;
+        return true;
+    }
+
+    // Room left in the ring.
+    int space() const { return Size - 1 - available(); }
+
+    unsigned long dropped() const { return mDropped; }
+    unsigned long written() const { return mWritten; }
+
+private:
+    uint8_t mRing[Size];
+    unsigned int mHead;
+    unsigned int mTail;
+    unsigned long mDropped;
+    unsigned long mWritten;
+};
+
+#endif // HOST_RINGTRANSPORT_H_
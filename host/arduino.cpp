@@ -0,0 +1,246 @@
+#include <time.h>
+#include "Arduino.h"
+#include "host.h"
+#include <util/delay.h>
+
+volatile uint8_t DDRB;
+hostPort PORTB(8, 6);
+volatile uint8_t PINB;
+volatile uint8_t TCCR1A;
+volatile uint8_t TCCR1B;
+volatile uint16_t OCR1A;
+volatile uint8_t TCCR2A;
+volatile uint8_t TCCR2B;
+volatile uint8_t OCR2A;
+volatile uint8_t TIMSK2;
+volatile uint8_t SPCR;
+hostPort PORTC(A0, 6);
+hostSpiStatus SPSR;
+hostSpiData SPDR;
+
+// What pin I/O costs on the AVR, in cycles.
+static const unsigned long digitalWriteCycles = 56; // Pin table lookups, PWM check, cli/sei.
+static const unsigned long shiftOutBitCycles = 12;  // shiftOut()'s loop around 3 digitalWrite()s.
+static const unsigned long ioCycles = 1;            // in, out.
+static const unsigned long bitCycles = 2;           // sbi, cbi.
+static const unsigned long pollCycles = 3;          // in, sbrs, rjmp around a busy wait.
+
+static uint8_t pinModes[NUM_DIGITAL_PINS];
+static uint8_t pinLevels[NUM_DIGITAL_PINS];
+static unsigned long skipped; // Microseconds skipped by delay().
+static uint64_t cycles;
+
+// Interrupts
+extern "C" void TIMER2_COMPA_vect(void) __attribute__((weak));
+static bool interruptsOn = true;
+static bool inInterrupt;
+static unsigned long interruptTime;  // micros() while an interrupt runs.
+static bool timer2Running;
+static unsigned long timer2Start;
+static uint64_t timer2Ticks;
+
+static uint8_t spiStatus;
+static uint64_t spiDone;      // hostCycles() when the transfer in progress ends.
+
+uint64_t hostNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+unsigned long hostMicros() {
+    static uint64_t start = hostNanos();
+    if (inInterrupt) return interruptTime;
+    return (unsigned long)((hostNanos() - start) / 1000) + skipped;
+}
+
+uint64_t hostCycles() {
+    return cycles;
+}
+
+void hostAddCycles(unsigned long n) {
+    cycles += n;
+}
+
+// Pins
+
+static void setLevel(uint8_t pin, uint8_t level) {
+    // Writing HIGH to an input enables its pull-up, which reads back HIGH.
+    if (pin >= NUM_DIGITAL_PINS) return;
+    if (pinLevels[pin] == level) return;
+    pinLevels[pin] = level;
+    if (pinModes[pin] == OUTPUT) hostPinChanged(pin, level);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < NUM_DIGITAL_PINS) pinModes[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    cycles += digitalWriteCycles;
+    setLevel(pin, val ? HIGH : LOW);
+}
+
+int digitalRead(uint8_t pin) {
+    if (pin >= NUM_DIGITAL_PINS) return LOW;
+    return pinLevels[pin];
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val) {
+    for (uint8_t i = 0; i < 8; i++) {
+        cycles += shiftOutBitCycles;
+        if (bitOrder == LSBFIRST) digitalWrite(dataPin, !!(val & (1 << i)));
+        else digitalWrite(dataPin, !!(val & (1 << (7 - i))));
+        digitalWrite(clockPin, HIGH);
+        digitalWrite(clockPin, LOW);
+    }
+}
+
+// Ports
+
+hostPort::operator uint8_t() const {
+    cycles += ioCycles;
+    uint8_t val = 0;
+    for (uint8_t i = 0; i < mPins; i++) {
+        if (pinLevels[mFirstPin + i]) val |= _BV(i);
+    }
+    return val;
+}
+
+hostPort &hostPort::operator=(uint8_t val) {
+    cycles += ioCycles;
+    for (uint8_t i = 0; i < mPins; i++) setLevel(mFirstPin + i, val & _BV(i) ? HIGH : LOW);
+    return *this;
+}
+
+hostPort &hostPort::operator|=(uint8_t mask) {
+    cycles += bitCycles;
+    for (uint8_t i = 0; i < mPins; i++) {
+        if (mask & _BV(i)) setLevel(mFirstPin + i, HIGH);
+    }
+    return *this;
+}
+
+hostPort &hostPort::operator&=(uint8_t mask) {
+    cycles += bitCycles;
+    for (uint8_t i = 0; i < mPins; i++) {
+        if (!(mask & _BV(i))) setLevel(mFirstPin + i, LOW);
+    }
+    return *this;
+}
+
+// SPI, master mode 0 only.
+
+static const uint8_t spiMosi = 11;
+static const uint8_t spiSck = 13;
+
+hostSpiStatus::operator uint8_t() const {
+    cycles += pollCycles;
+    if (spiDone && cycles >= spiDone) {
+        spiStatus |= _BV(SPIF);
+        spiDone = 0;
+    }
+    return spiStatus;
+}
+
+hostSpiStatus &hostSpiStatus::operator=(uint8_t val) {
+    cycles += ioCycles;
+    spiStatus = (spiStatus & ~_BV(SPI2X)) | (val & _BV(SPI2X));
+    return *this;
+}
+
+hostSpiData::operator uint8_t() const {
+    cycles += ioCycles;
+    spiStatus &= ~_BV(SPIF);
+    return 0;
+}
+
+hostSpiData &hostSpiData::operator=(uint8_t val) {
+    cycles += ioCycles;
+    if (!(SPCR & _BV(SPE)) || !(SPCR & _BV(MSTR))) return *this;
+    // Writing SPDR clears SPIF (the AVR wants SPSR read first).
+    spiStatus &= ~_BV(SPIF);
+    for (uint8_t i = 0; i < 8; i++) {
+        uint8_t bit = SPCR & _BV(DORD) ? i : 7 - i;
+        setLevel(spiMosi, val & _BV(bit) ? HIGH : LOW);
+        setLevel(spiSck, HIGH);
+        setLevel(spiSck, LOW);
+    }
+    // Two CPU cycles a bit at SPI2X with SPR1:0 clear, four without. The
+    // other dividers are not modelled.
+    spiDone = cycles + (spiStatus & _BV(SPI2X) ? 16 : 32);
+    return *this;
+}
+
+// Time
+
+unsigned long millis(void) {
+    hostRunInterrupts();
+    return hostMicros() / 1000;
+}
+
+unsigned long micros(void) {
+    hostRunInterrupts();
+    return hostMicros();
+}
+
+void delay(unsigned long ms) {
+    skipped += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+    skipped += us;
+}
+
+void _delay_us(double us) {
+    cycles += (uint64_t)(us * (F_CPU / 1000000UL));
+}
+
+void _delay_ms(double ms) {
+    cycles += (uint64_t)(ms * (F_CPU / 1000UL));
+}
+
+// Interrupts. Only Timer2 compare match is raised, the external interrupts
+// never are.
+
+void hostRunInterrupts() {
+    if (!interruptsOn || inInterrupt || !TIMER2_COMPA_vect) return;
+    // CTC mode with the compare interrupt enabled, clocked.
+    static const unsigned int prescale[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+    unsigned int divider = prescale[TCCR2B & 7];
+    if (!(TCCR2A & _BV(WGM21)) || !(TIMSK2 & _BV(OCIE2A)) || !divider) {
+        timer2Running = false;
+        return;
+    }
+    unsigned long now = hostMicros();
+    if (!timer2Running) {
+        timer2Running = true;
+        timer2Start = now;
+        timer2Ticks = 0;
+        return;
+    }
+    double period = divider * (OCR2A + 1) / 16.0;
+    for (;;) {
+        unsigned long due = timer2Start + (unsigned long)((timer2Ticks + 1) * period);
+        if ((long)(now - due) < 0) break;
+        timer2Ticks++;
+        inInterrupt = true;
+        interruptTime = due;
+        TIMER2_COMPA_vect();
+        inInterrupt = false;
+    }
+}
+
+void attachInterrupt(uint8_t, void (*)(void), int) {}
+void detachInterrupt(uint8_t) {}
+
+void interrupts(void) {
+    interruptsOn = true;
+    hostRunInterrupts();
+}
+
+void noInterrupts(void) {
+    // Anything due before interrupts go off runs first.
+    hostRunInterrupts();
+    interruptsOn = false;
+}
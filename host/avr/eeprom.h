@@ -0,0 +1,23 @@
+/*
+ * Host stand-in for <avr/eeprom.h>.
+ *
+ * The ATmega328's 1KB, erased (all 0xFF) unless hostEepromOpen() backs it
+ * with a file, which then sees every write. A byte write takes the 3.4ms it
+ * does on the chip: eeprom_is_ready() is false until it is done, and a read
+ * or write before then waits it out, moving the clock on as delay() does.
+ */
+#ifndef HOST_AVR_EEPROM_H_
+#define HOST_AVR_EEPROM_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <avr/io.h>
+
+uint8_t eeprom_read_byte(const uint8_t *addr);
+void eeprom_write_byte(uint8_t *addr, uint8_t val);
+void eeprom_read_block(void *dest, const void *src, size_t n);
+
+bool hostEepromReady();
+#define eeprom_is_ready() hostEepromReady()
+
+#endif // HOST_AVR_EEPROM_H_
@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for <avr/interrupt.h>.
+ *
+ * An ISR() is a plain function the host calls itself, see
+ * hostRunInterrupts(). Only the vectors the sketch uses are defined.
+ */
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+#define ISR(vector, ...) extern "C" void vector(void)
+#define ISR_NOBLOCK
+
+#define TIMER2_COMPA_vect hostTimer2CompA
+
+#endif // HOST_AVR_INTERRUPT_H_
@@ -0,0 +1,104 @@
+/*
+ * Host stand-in for <avr/io.h>.
+ *
+ * The sketch programs a handful of ATmega328 registers directly (Timer1 for
+ * the SID clock, Timer2 for the SID write queue). On the host most are plain variables so the firmware
+ * compiles unchanged; nothing reacts to the values written.
+ *
+ * The exceptions are the ones the SID bus drives (see sidbus.h): PORTC and
+ * PORTB change the levels of pins A0-A5 and D8-D13, and SPDR shifts a byte
+ * out on MOSI and
+ * SCK, both as digitalWrite() would. Each access also costs the cycles it
+ * would on the AVR, see hostCycles().
+ */
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <inttypes.h>
+
+#define _BV(bit) (1 << (bit))
+
+// A port's output register, `pins` pins from `firstPin` up. Only the forms
+// the bus uses are provided: |= and &= with a constant single bit (sbi and
+// cbi on the AVR), read and assign.
+class hostPort {
+public:
+    hostPort(uint8_t firstPin, uint8_t pins) : mFirstPin(firstPin), mPins(pins) {}
+    operator uint8_t() const;
+    hostPort &operator=(uint8_t val);
+    hostPort &operator|=(uint8_t mask);
+    hostPort &operator&=(uint8_t mask);
+
+private:
+    uint8_t mFirstPin;
+    uint8_t mPins;
+};
+
+// Last EEPROM address: 1KB, see <avr/eeprom.h>.
+#define E2END 0x3FF
+
+// Port B, pins D8-D13.
+extern volatile uint8_t DDRB;
+extern hostPort PORTB;
+extern volatile uint8_t PINB;
+#define DDB1 1
+#define PORTB3 3
+#define PORTB4 4
+#define PORTB5 5
+
+// Port C, pins A0-A5.
+extern hostPort PORTC;
+#define PORTC0 0
+#define PORTC1 1
+#define PORTC2 2
+#define PORTC3 3
+
+// SPI. Writing SPDR in master mode shifts the byte out on MOSI (D11) and SCK
+// (D13); SPIF reads set once the transfer would have finished.
+class hostSpiStatus {
+public:
+    operator uint8_t() const;
+    hostSpiStatus &operator=(uint8_t val);
+};
+
+class hostSpiData {
+public:
+    operator uint8_t() const;
+    hostSpiData &operator=(uint8_t val);
+};
+
+extern volatile uint8_t SPCR;
+extern hostSpiStatus SPSR;
+extern hostSpiData SPDR;
+#define SPE 6
+#define DORD 5
+#define MSTR 4
+#define CPOL 3
+#define CPHA 2
+#define SPR1 1
+#define SPR0 0
+#define SPIF 7
+#define WCOL 6
+#define SPI2X 0
+
+// Timer/Counter1
+extern volatile uint8_t TCCR1A;
+extern volatile uint8_t TCCR1B;
+extern volatile uint16_t OCR1A;
+#define COM1A0 6
+#define WGM12 3
+#define CS10 0
+
+// Timer/Counter2. setup() starts it in CTC mode for the SID write queue; the
+// host raises its compare interrupt, see hostRunInterrupts().
+extern volatile uint8_t TCCR2A;
+extern volatile uint8_t TCCR2B;
+extern volatile uint8_t OCR2A;
+extern volatile uint8_t TIMSK2;
+#define WGM21 1
+#define CS22 2
+#define CS21 1
+#define CS20 0
+#define OCIE2A 1
+
+#endif // HOST_AVR_IO_H_
@@ -0,0 +1,19 @@
+/*
+ * Host stand-in for <avr/pgmspace.h>.
+ *
+ * The host has one address space, so flash data is ordinary const data and
+ * the readers are plain loads.
+ */
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+
+#include <inttypes.h>
+#include <string.h>
+
+#define PROGMEM
+
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+
+#endif // HOST_AVR_PGMSPACE_H_
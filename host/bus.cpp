@@ -0,0 +1,74 @@
+/*
+ * The board between the AVR and the SID.
+ *
+ * Two cascaded 74HC595 shift registers share data (A0), latch (A1) and shift
+ * clock (A2), or data on MOSI (D11) and clock on SCK (D13) with the SPI bus
+ * backend; the SID's chip select is A3. See the wiring notes at the top of
+ * sidsystem.ino. Pin changes are decoded back into register writes: sixteen
+ * bits are shifted, the first byte shifted becomes the register address and
+ * the second the value, and a falling chip select writes them to the chip.
+ *
+ * With more than one SID, A3 goes through a 74HC139 that picks the chip
+ * from bits 5 and 6 of the address, or D11, D12 and D13 are the chip selects
+ * of chips 1-3 while the SPI is off (see sidbus.h).
+ */
+#include "Arduino.h"
+#include "host.h"
+
+static const uint8_t srData = A0;
+static const uint8_t srLatch = A1;
+static const uint8_t srClock = A2;
+static const uint8_t sidSelect = A3;
+static const uint8_t sidSelectPins[3] = {11, 12, 13};  // Chips 1-3.
+// The SPI bus backend shifts on MOSI and SCK instead of A0 and A2.
+static const uint8_t spiData = 11;
+static const uint8_t spiClock = 13;
+
+static uint8_t data;        // Level on A0.
+static uint8_t spiLevel;    // Level on MOSI.
+static uint16_t shifted;   // Shift register contents, first bit in at bit 0.
+static uint16_t latched;   // Storage register outputs.
+static unsigned long writes;
+static sidWriteHandler handler;
+
+void hostSetSidWriteHandler(sidWriteHandler fptr) {
+    handler = fptr;
+}
+
+unsigned long hostSidWrites() {
+    return writes;
+}
+
+double hostSidClockHz() {
+    // setup() toggles OC1A on compare match in CTC mode, so the output runs
+    // at half the compare rate. Only the undivided prescaler is modelled.
+    if (!(TCCR1A & _BV(COM1A0)) || !(TCCR1B & _BV(CS10))) return 0;
+    return 16000000.0 / (2.0 * (OCR1A + 1));
+}
+
+void hostPinChanged(uint8_t pin, uint8_t level) {
+    bool spi = SPCR & _BV(SPE);
+    if (pin == srData) {
+        data = level;
+    }
+    else if (!spi && level == LOW && pin >= sidSelectPins[0] && pin <= sidSelectPins[2]) {
+        writes++;
+        if (handler) handler(pin - sidSelectPins[0] + 1, latched & 0x1F, latched >> 8);
+    }
+    else if (spi && pin == spiData) {
+        spiLevel = level;
+    }
+    else if (pin == srClock && level == HIGH) {
+        shifted = (shifted >> 1) | (data ? 0x8000 : 0);
+    }
+    else if (spi && pin == spiClock && level == HIGH) {
+        shifted = (shifted >> 1) | (spiLevel ? 0x8000 : 0);
+    }
+    else if (pin == srLatch && level == HIGH) {
+        latched = shifted;
+    }
+    else if (pin == sidSelect && level == LOW) {
+        writes++;
+        if (handler) handler((latched >> 5) & 3, latched & 0x1F, latched >> 8);
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * SID bus benchmark.
+ *
+ * Runs the same register writes through each backend in sidbus.h and prints
+ * what they cost in simulated AVR cycles (see hostCycles()): per register,
+ * for a whole patch (all 25 registers) and for a note on (frequency and
+ * control of three voices), and the most register writes a second the bus
+ * leaves room for at 16MHz. Every write is decoded back off the pins, as
+ * sidsystem-host does; the run fails if any backend delivers something other
+ * than what it was given, or to another chip. The random writes go to every
+ * chip SID_CHIPS allows, through the SID_SELECT wiring.
+ *
+ *     host/busbench [random writes]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "Arduino.h"
+#include "host.h"
+#include "../patch.h"
+#include "../sidbus.h"
+
+namespace {
+
+struct sidWrite {
+    uint8_t chip;
+    uint8_t reg;
+    uint8_t val;
+};
+
+std::vector<sidWrite> decoded;
+
+void record(uint8_t chip, uint8_t reg, uint8_t val) {
+    sidWrite w = {chip, reg, val};
+    decoded.push_back(w);
+}
+
+struct result {
+    double cycles;          // Per register.
+    bool same;
+};
+
+template<class Bus>
+result run(const std::vector<sidWrite> &writes) {
+    decoded.clear();
+    uint64_t start = hostCycles();
+    for (size_t i = 0; i < writes.size(); i++) Bus::write(writes[i].chip, writes[i].reg, writes[i].val);
+    result r;
+    r.cycles = writes.empty() ? 0 : (double)(hostCycles() - start) / writes.size();
+    r.same = decoded.size() == writes.size();
+    for (size_t i = 0; r.same && i < writes.size(); i++) {
+        r.same = decoded[i].chip == writes[i].chip && decoded[i].reg == writes[i].reg
+            && decoded[i].val == writes[i].val;
+    }
+    return r;
+}
+
+std::vector<sidWrite> patchLoad() {
+    std::vector<sidWrite> s;
+    for (uint8_t i = 0; i < 25; i++) {
+        sidWrite w = {0, i, (uint8_t)(i * 37 + 5)};
+        s.push_back(w);
+    }
+    return s;
+}
+
+std::vector<sidWrite> noteOn() {
+    std::vector<sidWrite> s;
+    for (uint8_t v = 0; v < 3; v++) {
+        sidWrite lo = {0, (uint8_t)(v * 7), 0x6B}, hi = {0, (uint8_t)(v * 7 + 1), 0x11};
+        sidWrite ctrl = {0, (uint8_t)(v * 7 + 4), 0x41};
+        s.push_back(lo);
+        s.push_back(hi);
+        s.push_back(ctrl);
+    }
+    return s;
+}
+
+std::vector<sidWrite> randomWrites(unsigned int count) {
+    std::vector<sidWrite> s;
+    srand(1);
+    for (unsigned int i = 0; i < count; i++) {
+        sidWrite w = {(uint8_t)(rand() % SID_CHIPS), (uint8_t)(rand() % 25), (uint8_t)rand()};
+        s.push_back(w);
+    }
+    return s;
+}
+
+template<class Bus>
+bool report(const char *name, const std::vector<sidWrite> &random) {
+    Bus::begin();
+    result r = run<Bus>(random);
+    result patch = run<Bus>(patchLoad());
+    result note = run<Bus>(noteOn());
+    bool same = r.same && patch.same && note.same;
+    printf("%-10s %12.1f %10.2f %12.1f %12.1f %12.0f%s\n", name, r.cycles, r.cycles / 16,
+           patch.cycles * 25 / 16, note.cycles * 9 / 16, 16e6 / r.cycles, same ? "" : "  MISMATCH");
+    return same;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    unsigned int count = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+    std::vector<sidWrite> random = randomWrites(count ? count : 10000);
+    hostSetSidWriteHandler(record);
+
+    printf("%-10s %12s %10s %12s %12s %12s\n", "backend", "cycles/reg", "us/reg",
+           "patch us", "note on us", "max regs/s");
+    bool same = true;
+    same &= report<sidBusShiftOut>("shiftOut", random);
+    same &= report<sidBusPort>("port", random);
+#if SID_SELECT != SID_SELECT_PINS
+    same &= report<sidBusSpi>("spi", random);
+#endif
+    return same ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "Arduino.h"
+#include "host.h"
+#include <avr/eeprom.h>
+
+static const unsigned long writeMicros = 3400;  // tWD_EEPROM, with margin.
+
+static uint8_t memory[E2END + 1];
+static bool erased;
+static int backing = -1;
+static bool busy;
+static unsigned long busyUntil;
+static unsigned long writes;
+
+static void erase() {
+    if (erased) return;
+    memset(memory, 0xFF, sizeof(memory));
+    erased = true;
+}
+
+// Waits for the write in progress, as the AVR busy waits on EEPE.
+static void waitReady() {
+    if (!busy) return;
+    long left = (long)(busyUntil - hostMicros());
+    if (left > 0) delayMicroseconds(left);
+    busy = false;
+}
+
+bool hostEepromOpen(const char *path) {
+    erase();
+    backing = open(path, O_RDWR | O_CREAT, 0644);
+    if (backing < 0) return false;
+    // A new or short file reads as erased past its end.
+    ssize_t n = pread(backing, memory, sizeof(memory), 0);
+    if (n < 0) n = 0;
+    if ((size_t)n < sizeof(memory) && pwrite(backing, memory + n, sizeof(memory) - n, n) < 0) {
+        close(backing);
+        backing = -1;
+        return false;
+    }
+    return true;
+}
+
+unsigned long hostEepromWrites() {
+    return writes;
+}
+
+bool hostEepromReady() {
+    return !busy || (long)(busyUntil - hostMicros()) <= 0;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr) {
+    erase();
+    waitReady();
+    return memory[(size_t)addr & E2END];
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t val) {
+    erase();
+    waitReady();
+    size_t a = (size_t)addr & E2END;
+    memory[a] = val;
+    if (backing >= 0 && pwrite(backing, &val, 1, a) < 0) perror("eeprom");
+    writes++;
+    busy = true;
+    busyUntil = hostMicros() + writeMicros;
+}
+
+void eeprom_read_block(void *dest, const void *src, size_t n) {
+    for (size_t i = 0; i < n; i++) ((uint8_t *)dest)[i] = eeprom_read_byte((const uint8_t *)src + i);
+}
@@ -0,0 +1,51 @@
+/*
+ * Host-only controls for the Arduino stand-ins.
+ */
+#ifndef HOST_HOST_H_
+#define HOST_HOST_H_
+
+#include <inttypes.h>
+
+// Time seen by millis()/micros() is the host's monotonic clock plus any time
+// skipped by delay(). delay() does not sleep, it moves the clock forward, so
+// a run is never slower than the work it does.
+unsigned long hostMicros();
+
+// Host wall time in nanoseconds, for measuring the sketch itself.
+uint64_t hostNanos();
+
+// Simulated ATmega328 cycles spent on pin I/O since start up: digitalWrite()
+// and shiftOut(), the PORTC and SPI registers and _delay_us(). The costs are
+// those of the Arduino 1.0.1 core and avr-gcc -Os at 16MHz, as set out in
+// arduino.cpp; loop overhead in the sketch itself is not counted. Good for
+// comparing bus backends, not for exact timing.
+uint64_t hostCycles();
+void hostAddCycles(unsigned long cycles);
+
+// Raise the Timer2 compare interrupt for every period that has passed since
+// it last ran, with micros() reading the time it was due while it runs. The
+// host has no real interrupts: this is called from micros(), millis(),
+// noInterrupts() and interrupts(), the places the sketch touches the clock
+// or shared state, and does nothing while interrupts are off.
+void hostRunInterrupts();
+
+// Called by digitalWrite() when an output pin changes level.
+void hostPinChanged(uint8_t pin, uint8_t level);
+
+// Register writes decoded from the shift registers and chip selects, with
+// the chip each went to (see SID_SELECT in sidbus.h).
+typedef void (*sidWriteHandler)(uint8_t chip, uint8_t reg, uint8_t val);
+void hostSetSidWriteHandler(sidWriteHandler fptr);
+unsigned long hostSidWrites();
+
+// The SID clock Timer1 has been programmed to produce, or 0 if it is off.
+double hostSidClockHz();
+
+// Back the EEPROM (<avr/eeprom.h>) with the file at `path`, created erased
+// if need be. False, with errno set, if it can't be opened.
+bool hostEepromOpen(const char *path);
+
+// EEPROM bytes written since start up.
+unsigned long hostEepromWrites();
+
+#endif // HOST_HOST_H_
@@ -0,0 +1,302 @@
+/*
+ * Runs the sketch natively: setup() once, then loop() as fast as the host
+ * allows while `Serial` is fed MIDI from a file, a pipe or a pty.
+ */
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "Arduino.h"
+#include "LiquidCrystal.h"
+#include "host.h"
+#include "render.h"
+#include "sid.h"
+#include "smf.h"
+#include "../sidtrace.h"
+#include "wav.h"
+#include "../patch.h"
+
+void setup();
+void loop();
+extern void (*sidWriteTap)(unsigned long time, uint8_t chip, uint8_t reg, uint8_t val);
+
+static volatile sig_atomic_t stopped = 0;
+
+static void onSignal(int) { stopped = 1; }
+
+static Sid6581 sids[SID_CHIPS];
+
+// Writes are collected during a pass and rendered between passes, so the
+// emulator's cost doesn't show up in the loop() timings.
+struct sidWrite {
+    unsigned long micros;
+    uint8_t chip;
+    uint8_t reg;
+    uint8_t val;
+};
+static std::vector<sidWrite> sidWrites;
+
+static void onSidWrite(uint8_t chip, uint8_t reg, uint8_t val) {
+    sidWrite w = {micros(), chip, reg, val};
+    sidWrites.push_back(w);
+}
+
+// Register trace, from the sketch's tap on writeSidRegister().
+static FILE *traceFile;
+static sidTrace trace;
+
+static void tracePut(uint8_t b) {
+    fputc(b, traceFile);
+}
+
+// The sketch's tap on writeSidRegister(), called once the bus has taken the
+// write: checks that the write came off the pins for the chip the sketch
+// meant it for, and traces it.
+static unsigned long chipWrites[4];
+static unsigned long misrouted;
+
+static void onTappedWrite(unsigned long time, uint8_t chip, uint8_t reg, uint8_t val) {
+    chipWrites[chip & 3]++;
+    if (sidWrites.empty()) misrouted++;
+    else {
+        const sidWrite &w = sidWrites.back();
+        if (w.chip != chip || w.reg != reg || w.val != val) misrouted++;
+    }
+    if (traceFile) traceSidWrite(&trace, time, chip, reg, val);
+}
+
+static void renderWrites(SidRenderer *pRenderer) {
+    for (size_t i = 0; i < sidWrites.size(); i++) {
+        pRenderer->write(sidWrites[i].micros, sidWrites[i].chip, sidWrites[i].reg, sidWrites[i].val);
+    }
+    sidWrites.clear();
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [options] [midi-input]\n"
+        "\n"
+        "Feeds midi-input (a file, a fifo or - for stdin) to Serial and runs\n"
+        "loop() until it has been consumed. A Standard MIDI File is played with\n"
+        "its timing, other input is taken as raw MIDI bytes.\n"
+        "\n"
+        "  -p, --pty           read from a new pseudo terminal instead\n"
+        "  -u, --unpaced       deliver input as fast as it is read, not at 31250 baud\n"
+        "  -f, --fast          play a MIDI file as fast as possible, ignoring its timing\n"
+        "  -x, --tempo SCALE   play a MIDI file SCALE times faster than its tempo\n"
+        "  -o, --output FILE   write MIDI sent by the sketch to FILE (- for stdout)\n"
+        "  -s, --seconds N     stop after N seconds of sketch time\n"
+        "  -n, --loops N       stop after N passes of loop()\n"
+        "  -l, --lcd           print the LCD to stderr when it changes\n"
+        "  -w, --wav FILE      render the emulated SID to a 16 bit WAV file\n"
+        "  -r, --rate HZ       WAV sample rate (default 44100)\n"
+        "  -t, --tail N        keep rendering N seconds after the input ends (default 1)\n"
+        "  -T, --trace FILE    record every SID register write to FILE (see host/sidreplay)\n"
+        "  -e, --eeprom FILE   keep the EEPROM, and the user patches in it, in FILE\n",
+        name);
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+        {"pty", no_argument, NULL, 'p'},
+        {"unpaced", no_argument, NULL, 'u'},
+        {"fast", no_argument, NULL, 'f'},
+        {"tempo", required_argument, NULL, 'x'},
+        {"output", required_argument, NULL, 'o'},
+        {"seconds", required_argument, NULL, 's'},
+        {"loops", required_argument, NULL, 'n'},
+        {"lcd", no_argument, NULL, 'l'},
+        {"wav", required_argument, NULL, 'w'},
+        {"rate", required_argument, NULL, 'r'},
+        {"tail", required_argument, NULL, 't'},
+        {"trace", required_argument, NULL, 'T'},
+        {"eeprom", required_argument, NULL, 'e'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    bool usePty = false;
+    bool paced = true;
+    bool fast = false;
+    double tempoScale = 1.0;
+    double seconds = 0;
+    unsigned long maxLoops = 0;
+    const char *wavPath = NULL;
+    const char *outPath = NULL;
+    const char *tracePath = NULL;
+    const char *eepromPath = NULL;
+    unsigned long sampleRate = 44100;
+    double tail = 1.0;
+    int c;
+
+    while ((c = getopt_long(argc, argv, "pufx:o:s:n:lw:r:t:T:e:h", options, NULL)) != -1) {
+        switch (c) {
+            case 'p': usePty = true; break;
+            case 'u': paced = false; break;
+            case 'f': fast = true; break;
+            case 'x': tempoScale = atof(optarg); break;
+            case 'o': outPath = optarg; break;
+            case 's': seconds = atof(optarg); break;
+            case 'n': maxLoops = strtoul(optarg, NULL, 10); break;
+            case 'l': LiquidCrystal::setEcho(true); break;
+            case 'w': wavPath = optarg; break;
+            case 'r': sampleRate = strtoul(optarg, NULL, 10); break;
+            case 't': tail = atof(optarg); break;
+            case 'T': tracePath = optarg; break;
+            case 'e': eepromPath = optarg; break;
+            default: usage(argv[0]); return c == 'h' ? 0 : 2;
+        }
+    }
+
+    HostTransport *transport = NULL;
+    FdTransport *fdTransport = NULL;
+    SmfTransport *smf = NULL;
+    if (usePty) {
+        char name[128];
+        transport = fdTransport = FdTransport::openPty(name, sizeof(name));
+        if (transport) fprintf(stderr, "MIDI input on %s\n", name);
+    }
+    else if (optind < argc) {
+        const char *error = NULL;
+        if (strcmp(argv[optind], "-") != 0) smf = SmfTransport::open(argv[optind], &error);
+        if (error) {
+            fprintf(stderr, "%s: %s\n", argv[optind], error);
+            return 1;
+        }
+        if (smf) {
+            smf->setFast(fast);
+            smf->setTempoScale(tempoScale);
+            transport = smf;
+        }
+        else {
+            transport = fdTransport = FdTransport::open(argv[optind]);
+            if (transport == NULL) perror(argv[optind]);
+        }
+    }
+    else {
+        usage(argv[0]);
+        return 2;
+    }
+    if (transport == NULL) return 1;
+
+    if (outPath) {
+        int fd = strcmp(outPath, "-") == 0 ? 1 : open(outPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror(outPath);
+            return 1;
+        }
+        if (smf) smf->setOutput(fd);
+        else fdTransport->setOutput(fd);
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    WavWriter wav;
+    if (wavPath && !wav.open(wavPath, sampleRate)) {
+        perror(wavPath);
+        return 1;
+    }
+    if (eepromPath && !hostEepromOpen(eepromPath)) {
+        perror(eepromPath);
+        return 1;
+    }
+    hostSetSidWriteHandler(onSidWrite);
+    sidWriteTap = onTappedWrite;
+
+    Serial.setPaced(paced);
+    Serial.attach(transport);
+    setup();
+
+    // The chip runs from the clock setup() programs on Timer1.
+    double clockHz = hostSidClockHz();
+    if (clockHz == 0) {
+        fprintf(stderr, "warning: SID clock not running, assuming 1MHz\n");
+        clockHz = 1000000.0;
+    }
+    if (tracePath) {
+        traceFile = fopen(tracePath, "wb");
+        if (traceFile == NULL) {
+            perror(tracePath);
+            return 1;
+        }
+        beginSidTrace(&trace, tracePut, (uint32_t)clockHz);
+    }
+    SidRenderer sidRenderer(sids, SID_CHIPS, wavPath ? &wav : NULL, clockHz, sampleRate);
+    renderWrites(&sidRenderer);
+    // Catch the chips up with the time setup() took now, not between the
+    // first passes, where with several chips it is long enough for MIDI
+    // input to overrun.
+    sidRenderer.renderTo(micros());
+
+    unsigned long passes = 0;
+    uint64_t busy = 0;
+    uint64_t worst = 0;
+    unsigned long limit = seconds > 0 ? (unsigned long)(seconds * 1e6) + micros() : 0;
+
+    while (!stopped) {
+        if (maxLoops && passes >= maxLoops) break;
+        if (limit && micros() >= limit) break;
+        if (!usePty && Serial.exhausted()) break;
+
+        uint64_t t = hostNanos();
+        loop();
+        t = hostNanos() - t;
+        busy += t;
+        if (t > worst) worst = t;
+        passes++;
+        renderWrites(&sidRenderer);
+    }
+
+    // Give the timer time to write what is still queued.
+    delay(20);
+    hostRunInterrupts();
+    renderWrites(&sidRenderer);
+
+    fprintf(stderr, "loop passes     %lu\n", passes);
+    fprintf(stderr, "mean pass       %.3f us\n", passes ? busy / 1e3 / passes : 0.0);
+    fprintf(stderr, "worst pass      %.3f us\n", worst / 1e3);
+    if (smf) {
+        fprintf(stderr, "file messages   %lu to %.3f s\n", smf->messages(), smf->position() / 1e6);
+    }
+    fprintf(stderr, "bytes received  %lu\n", Serial.received());
+    fprintf(stderr, "bytes overrun   %lu\n", Serial.overruns());
+    fprintf(stderr, "SID writes      %lu\n", hostSidWrites());
+    if (hostEepromWrites()) fprintf(stderr, "EEPROM writes   %lu\n", hostEepromWrites());
+    if (SID_CHIPS > 1) {
+        fprintf(stderr, "chip writes    ");
+        for (int i = 0; i < SID_CHIPS; i++) fprintf(stderr, " %lu", chipWrites[i]);
+        fprintf(stderr, ", %lu misrouted\n", misrouted);
+    }
+    else if (misrouted) {
+        fprintf(stderr, "misrouted       %lu\n", misrouted);
+    }
+
+    Sid6581::latency l = sids[0].gateLatency();
+    for (int i = 1; i < SID_CHIPS; i++) {
+        const Sid6581::latency &m = sids[i].gateLatency();
+        if (!m.count) continue;
+        if (!l.count || m.min < l.min) l.min = m.min;
+        if (!l.count || m.max > l.max) l.max = m.max;
+        l.count += m.count;
+        l.total += m.total;
+    }
+    if (l.count) {
+        fprintf(stderr, "gate latency    min %.1f / mean %.1f / max %.1f us over %lu gates\n",
+                l.min * 1e6 / clockHz, (double)l.total / l.count * 1e6 / clockHz,
+                l.max * 1e6 / clockHz, l.count);
+    }
+
+    if (wavPath) {
+        sidRenderer.renderTo(micros() + (unsigned long)(tail * 1e6));
+        fprintf(stderr, "WAV samples     %lu (%.2f s)\n", wav.samples(),
+                (double)wav.samples() / sampleRate);
+        wav.close();
+    }
+
+    if (traceFile) fclose(traceFile);
+    delete transport;
+    return 0;
+}
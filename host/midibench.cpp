@@ -0,0 +1,170 @@
+/*
+ * Parser throughput benchmark.
+ *
+ * Feeds the same byte streams through two MIDI_Static instances, one with
+ * the running status fast path and one without, and prints the messages
+ * parsed per second by each. Both must see exactly the same messages; the
+ * run fails if their checksums differ.
+ *
+ *     host/midibench [seconds per case]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include "../MIDI.h"
+#include "RingTransport.h"
+
+struct slowSettings : MIDI_DefaultSettings {
+    static const bool UseRunningStatusFastPath = false;
+};
+
+// Sum of every message delivered, so the two parsers can be compared and the
+// compiler cannot drop the work.
+static unsigned long checksum;
+static unsigned long messages;
+
+static inline void tally(byte type, byte channel, byte data1, byte data2) {
+    checksum = checksum * 31 + (type ^ channel << 8 ^ data1 << 12 ^ data2 << 20);
+    messages++;
+}
+
+struct benchHandler : MIDI_NullHandler {
+    static inline void noteOn(byte channel, byte note, byte velocity) { tally(NoteOn, channel, note, velocity); }
+    static inline void noteOff(byte channel, byte note, byte velocity) { tally(NoteOff, channel, note, velocity); }
+    static inline void controlChange(byte channel, byte number, byte value) { tally(ControlChange, channel, number, value); }
+    static inline void programChange(byte channel, byte number) { tally(ProgramChange, channel, number, 0); }
+    static inline void pitchBend(byte channel, int bend) { tally(PitchBend, channel, bend & 0xFF, bend >> 8); }
+    static inline void clock() { tally(Clock, 0, 0, 0); }
+};
+
+typedef RingTransport<128> port;
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct result {
+    double rate;
+    unsigned long checksum;
+    unsigned long messages;
+};
+
+// Parse `stream` over and over for about `seconds`.
+template<class Settings>
+static result run(const std::vector<byte> &stream, double seconds) {
+    port p;
+    MIDI_Static<benchHandler, port, Settings> midi(p);
+    midi.begin(MIDI_CHANNEL_OMNI);
+
+    checksum = messages = 0;
+    unsigned long passes = 0;
+    double start = now(), elapsed;
+    do {
+        // Stay clear of the overflow check, which fires at a full ring.
+        for (size_t i = 0; i < stream.size(); ) {
+            while (i < stream.size() && p.space() > 32) p.push(stream[i++]);
+            midi.readBatch(128);
+        }
+        while (p.available()) midi.readBatch(128);
+        passes++;
+        elapsed = now() - start;
+    } while (elapsed < seconds);
+
+    result r = {messages / elapsed, checksum, messages / passes};
+    return r;
+}
+
+static std::vector<byte> ccSweep() {
+    // One status byte, then a long running status run of controller values.
+    std::vector<byte> s;
+    for (int cc = 0; cc < 8; cc++) {
+        s.push_back(0xB0 | (cc & 0x0F));
+        for (int v = 0; v < 128; v++) {
+            s.push_back(cc + 1);
+            s.push_back(v);
+        }
+    }
+    return s;
+}
+
+static std::vector<byte> noteStream() {
+    // Note on and off (velocity 0) under a single running status.
+    std::vector<byte> s;
+    s.push_back(0x90);
+    for (int n = 0; n < 512; n++) {
+        s.push_back(36 + n % 48);
+        s.push_back(100);
+        s.push_back(36 + n % 48);
+        s.push_back(0);
+    }
+    return s;
+}
+
+static std::vector<byte> sweepWithClock() {
+    // Controller sweep with a timing clock after every 6th message.
+    std::vector<byte> s;
+    s.push_back(0xB0);
+    for (int v = 0; v < 1024; v++) {
+        s.push_back(74);
+        s.push_back(v & 0x7F);
+        if (v % 6 == 5) s.push_back(0xF8);
+    }
+    return s;
+}
+
+static std::vector<byte> explicitStatus() {
+    // Every message has its status: the fast path never applies.
+    std::vector<byte> s;
+    for (int n = 0; n < 1024; n++) {
+        s.push_back(n % 3 == 0 ? 0x90 : n % 3 == 1 ? 0xB1 : 0xE2);
+        s.push_back(n & 0x7F);
+        s.push_back((n * 7) & 0x7F);
+    }
+    return s;
+}
+
+static std::vector<byte> mixed() {
+    // Running status runs of varying type, with program changes and clocks.
+    std::vector<byte> s;
+    for (int n = 0; n < 256; n++) {
+        s.push_back(0xB0 | (n & 3));
+        for (int i = 0; i < 4; i++) { s.push_back(i + 1); s.push_back(n & 0x7F); }
+        s.push_back(0xC0);
+        s.push_back(n & 0x7F);
+        s.push_back(0xF8);
+        s.push_back(0xE0);
+        s.push_back(0); s.push_back(n & 0x7F);
+        s.push_back(0x40); s.push_back(0xF8); s.push_back(n & 0x7F);
+    }
+    return s;
+}
+
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 0.5;
+    struct { const char *name; std::vector<byte> stream; } cases[] = {
+        {"cc sweep", ccSweep()},
+        {"note stream", noteStream()},
+        {"sweep + clock", sweepWithClock()},
+        {"explicit status", explicitStatus()},
+        {"mixed", mixed()},
+    };
+
+    int failed = 0;
+    printf("%-16s %14s %14s %8s\n", "stream", "current msg/s", "fast msg/s", "speedup");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        result slow = run<slowSettings>(cases[i].stream, seconds);
+        result fast = run<MIDI_DefaultSettings>(cases[i].stream, seconds);
+        // Both ran whole passes over the same stream, so the per-pass counts
+        // and a fresh single pass checksum must agree.
+        result slowOnce = run<slowSettings>(cases[i].stream, 0);
+        result fastOnce = run<MIDI_DefaultSettings>(cases[i].stream, 0);
+        bool same = slow.messages == fast.messages && slowOnce.checksum == fastOnce.checksum;
+        printf("%-16s %14.0f %14.0f %7.2fx%s\n", cases[i].name, slow.rate, fast.rate,
+               fast.rate / slow.rate, same ? "" : "  MISMATCH");
+        if (!same) failed = 1;
+    }
+    return failed;
+}
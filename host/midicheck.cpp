@@ -0,0 +1,130 @@
+/*
+ * MIDI input check.
+ *
+ * Overflows the receive buffer in the middle of running status streams,
+ * after every message of the stream in turn, with the cut-through
+ * Thru on, and checks that what the Thru forwarded, parsed again on a clean
+ * port, is exactly what the parser delivered: after an overflow both carry
+ * on under the running status the discarded bytes left, and neither passes
+ * on the rest of the message the overflow cut short. Run for the Full and
+ * the SameChannel filters.
+ *
+ * Fails, naming the first few mismatches, if they differ.
+ *
+ *     host/midicheck
+ *
+ * host/midicheck-callbacks is the same built with USE_CALLBACKS set, which
+ * the sketch leaves off, with every member of MIDI_Class compiled.
+ */
+#include <stdio.h>
+#include <vector>
+#include "../MIDI.h"
+#include "RingTransport.h"
+
+namespace {
+
+typedef RingTransport<128> port;
+
+// A port that keeps what is written to it, the Thru's output.
+struct thruPort : port {
+    std::vector<byte> sent;
+    size_t write(uint8_t b) { sent.push_back(b); return 1; }
+};
+
+struct message {
+    byte type, channel, data1, data2;
+    bool operator!=(const message &m) const {
+        return type != m.type || channel != m.channel || data1 != m.data1 || data2 != m.data2;
+    }
+};
+
+template<class Transport>
+void take(MIDI_Class<Transport> &midi, std::vector<message> *out) {
+    if (!midi.read()) return;
+    message m = {(byte)midi.getType(), midi.getChannel(), midi.getData1(), midi.getData2()};
+    out->push_back(m);
+}
+
+// Running status runs of notes, controllers, program changes and pitch
+// bends on channels 1-3, with clocks in between. `starts` gets the offset
+// of each message.
+std::vector<byte> stream(std::vector<size_t> *starts) {
+    std::vector<byte> s;
+    for (int n = 0; n < 40; n++) {
+        byte status = n % 4 == 0 ? 0x90 : n % 4 == 1 ? 0xB1 : n % 4 == 2 ? 0xC0 : 0xE2;
+        int len = status == 0xC0 ? 1 : 2;
+        for (int i = 0; i < 12; i++) {
+            starts->push_back(s.size());
+            if (i == 0) s.push_back(status);
+            for (int d = 0; d < len; d++) s.push_back((n * 13 + i * 7 + d) & 0x7F);
+            if (i % 5 == 4) {
+                starts->push_back(s.size());
+                s.push_back(0xF8);
+            }
+        }
+    }
+    return s;
+}
+
+unsigned int failures;
+
+// Feed the stream, reading as it arrives up to offset `at`, then letting the
+// port fill up before reading again, and compare.
+void check(const std::vector<byte> &s, size_t at, kThruFilterMode mode, byte channel) {
+    thruPort in;
+    MIDI_Class<thruPort> midi(in);
+    midi.begin(channel);
+    midi.turnThruOn(mode);
+    midi.setThruCutThrough(true);
+
+    std::vector<message> delivered;
+    for (size_t i = 0; i < s.size(); ) {
+        in.push(s[i++]);
+        if (i == at) {
+            while (i < s.size() && in.space() > 0) in.push(s[i++]);
+        }
+        while (in.available()) take(midi, &delivered);
+    }
+    if (midi.getInputStats().overflows != 1) {
+        if (failures++ < 10) printf("overflow at byte %zu: %u overflows\n", at, midi.getInputStats().overflows);
+        return;
+    }
+
+    port out;
+    MIDI_Class<port> again(out);
+    again.begin(MIDI_CHANNEL_OMNI);
+    std::vector<message> forwarded;
+    for (size_t i = 0; i < in.sent.size(); i++) {
+        out.push(in.sent[i]);
+        while (out.available()) take(again, &forwarded);
+    }
+
+    size_t n = delivered.size() > forwarded.size() ? delivered.size() : forwarded.size();
+    for (size_t i = 0; i < n; i++) {
+        bool same = i < delivered.size() && i < forwarded.size() && !(delivered[i] != forwarded[i]);
+        if (same) continue;
+        if (failures++ < 10) {
+            printf("overflow at byte %zu, filter %d: message %zu of %zu delivered, %zu forwarded differs\n",
+                   at, mode, i, delivered.size(), forwarded.size());
+        }
+        break;
+    }
+}
+
+} // namespace
+
+#if USE_CALLBACKS
+template class MIDI_Class<RingTransport<128> >;
+#endif
+
+int main() {
+    std::vector<size_t> starts;
+    std::vector<byte> s = stream(&starts);
+    size_t runs = 0;
+    for (size_t m = 1; starts[m] + 256 < s.size(); m++, runs++) {
+        check(s, starts[m], Full, MIDI_CHANNEL_OMNI);
+        check(s, starts[m], SameChannel, 1);
+    }
+    printf("%zu overflows under running status, Thru against parser: %u mismatches\n", runs * 2, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,367 @@
+/*
+ * Patch parameter check.
+ *
+ * Holds the descriptor table in patch.cpp to the switch statements it
+ * replaced, kept here as they were: for all 27 parameters over their whole
+ * range, the registers patchParamRegister() names, the values
+ * getPatchValue() reads back after putPatchValue(), and the registers
+ * patchUpdateRegisters() builds, from patches of random bytes. Two
+ * differences are expected and allowed for: OSC C's filter enable is bit
+ * 0x4 of register 23, not 0x2 (the old code is given the fix), and the
+ * routing bits of register 23 follow the filter enables where the old code
+ * set all three whenever resonance was written.
+ *
+ * The packing: PATCH_VALUES, which packs patches at compile time, has to
+ * agree with putPatchValue() for random values, and every factory sound has
+ * to unpack to the values factory.h gives it, so none is out of range.
+ *
+ * Then the incremental rebuild: from one full patchToRegisters(), a long
+ * run of random parameter edits through setPatchValue() and switches to
+ * factory and user patches through copyPatch(), each of which only
+ * recomputes the registers it changes, has to leave the registers just as a
+ * fresh full build of the same patch would, after every step.
+ *
+ * Fails, naming the first few mismatches, if anything else differs.
+ *
+ *     host/patchcheck [random patches] [incremental steps]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "Arduino.h"
+#include "../patch.h"
+#include "../bank.h"
+#include "../userbank.h"
+#include "../factory.h"
+
+namespace {
+
+// The value range of each parameter, as the sketch's menu offers it.
+const int ranges[PATCH_PARAMS] = {
+    8, 4096, 16, 16, 16, 16, 2,
+    8, 4096, 16, 16, 16, 16, 2, 240,
+    8, 4096, 16, 16, 16, 16, 2, 240,
+    2048, 16, 4,
+    16,
+};
+
+// The old patch: one int per parameter, and its registers.
+struct oldPatch {
+    int v[PATCH_PARAMS];
+    uint8_t registers[25];
+};
+
+uint16_t oldPatchParamRegister(int param) {
+    switch (param) {
+        // OSC A
+        case 0: return 4;           // Waveform
+        case 1: return (2 << 8 | 3);// Pulse width
+        case 2: return 5;           // Attack
+        case 3: return 5;           // Decay
+        case 4: return 6;           // Sustain
+        case 5: return 6;           // Release
+        case 6: return 23;          // Filter enable
+
+        // OSC B
+        case 7: return 11;
+        case 8: return (9 << 8 | 10);
+        case 9: return 12;
+        case 10: return 12;
+        case 11: return 13;
+        case 12: return 13;
+        case 13: return 23;
+        case 14: return (7 << 8 | 8); // Detune
+
+        // OSC C
+        case 15: return 18;
+        case 16: return (16 << 8 | 17);
+        case 17: return 19;
+        case 18: return 19;
+        case 19: return 20;
+        case 20: return 20;
+        case 21: return 23;
+        case 22: return (14 << 8 | 15);
+
+        // Filter
+        case 23: return (21 << 8) | 22; // Filter cutoff
+        case 24: return 23;             // Resonance
+        case 25: return 24;             // Filter mode
+
+        // General
+        case 26: return 24;             // Volume
+    }
+    return 0;
+}
+
+uint8_t oldWaveform(int wave) {
+    switch (wave) {
+        case 0: return 0x10;
+        case 1: return 0x20;
+        case 2: return 0x40;
+        case 3: return 0x14;
+        case 4: return 0x12;
+        case 5: return 0x22;
+        case 6: return 0x42;
+        case 7: return 0x80;
+    }
+    return 0;
+}
+
+void oldPatchUpdateRegister(oldPatch *p, int param) {
+    const int *v = p->v;
+    uint8_t *r = p->registers;
+    switch (param) {
+    case 0: r[4] = oldWaveform(v[0]); break;
+    case 1: r[2] = v[1] & 0xFF; r[3] = v[1] >> 8; break;
+    case 2: case 3: r[5] = (v[2] << 4) + v[3]; break;
+    case 4: case 5: r[6] = (v[4] << 4) + v[5]; break;
+    case 6: if (v[6] == 1) r[23] |= 0x1; else r[23] &= 0xFE; break;
+
+    case 7: r[11] = oldWaveform(v[7]); break;
+    case 8: r[9] = v[8] & 0xFF; r[10] = v[8] >> 8; break;
+    case 9: case 10: r[12] = (v[9] << 4) + v[10]; break;
+    case 11: case 12: r[13] = (v[11] << 4) + v[12]; break;
+    case 13: if (v[13] == 1) r[23] |= 0x2; else r[23] &= 0xFD; break;
+
+    case 15: r[18] = oldWaveform(v[15]); break;
+    case 16: r[16] = v[16] & 0xFF; r[17] = v[16] >> 8; break;
+    case 17: case 18: r[19] = (v[17] << 4) + v[18]; break;
+    case 19: case 20: r[20] = (v[19] << 4) + v[20]; break;
+    // With the fix: the old code used 0x2, OSC B's bit.
+    case 21: if (v[21] == 1) r[23] |= 0x4; else r[23] &= 0xFB; break;
+
+    case 23: r[21] = v[23] & 0x7; r[22] = v[23] >> 3; break;
+    case 24: r[23] = v[24] << 4 | 0x7; break;
+    case 25:
+    case 26:
+        switch (v[25]) {
+            case 0: r[24] = 0x10; break;
+            case 1: r[24] = 0x40; break;
+            case 2: r[24] = 0x20; break;
+            case 3: r[24] = 0x50; break;
+        }
+        break;
+    }
+}
+
+void oldPatchToRegisters(oldPatch *p) {
+    for (int i = 0; i < PATCH_PARAMS; i++) oldPatchUpdateRegister(p, i);
+}
+
+unsigned int failures;
+
+void fail(const char *what, int param, int val, int reg, int got, int want) {
+    if (failures++ < 10) {
+        printf("%s: param %d = %d, register %d is 0x%02X, expected 0x%02X\n",
+               what, param, val, reg, got, want);
+    }
+}
+
+void randomPatch(patchSettings *s) {
+    memset(s, 0, sizeof(*s));
+    for (int i = 0; i < PATCH_VALUES_LEN; i++) s->values[i] = rand();
+    // Only values in range: the old code has nothing to say about the rest.
+    for (int i = 0; i < PATCH_PARAMS; i++) {
+        putPatchValue(s, i, getPatchValue(s, i) % ranges[i]);
+    }
+}
+
+// The registers of `p` against the old code's, but for the routing bits,
+// which have to be the filter enables.
+void compareRegisters(const char *what, int param, int val, const livePatch *p, const oldPatch *o) {
+    for (int r = 0; r < 25; r++) {
+        uint8_t got = p->registers[r], want = o->registers[r];
+        if (r == 23) {
+            want = (want & 0xF0) | o->v[PATCH_FILTER_A] | o->v[PATCH_FILTER_B] << 1
+                | o->v[PATCH_FILTER_C] << 2;
+        }
+        if (got != want) fail(what, param, val, r, got, want);
+    }
+}
+
+void checkParamRegisters() {
+    for (int i = 0; i < PATCH_PARAMS; i++) {
+        if (patchParamRegister(i) != oldPatchParamRegister(i) && failures++ < 10) {
+            printf("patchParamRegister: param %d gives 0x%04X, expected 0x%04X\n",
+                   i, patchParamRegister(i), oldPatchParamRegister(i));
+        }
+    }
+}
+
+// Every value of every parameter reads back, and leaves the others alone.
+void checkValues(patchSettings *s) {
+    for (int i = 0; i < PATCH_PARAMS; i++) {
+        for (int val = 0; val < ranges[i]; val++) {
+            int before[PATCH_PARAMS];
+            for (int j = 0; j < PATCH_PARAMS; j++) before[j] = getPatchValue(s, j);
+            putPatchValue(s, i, val);
+            for (int j = 0; j < PATCH_PARAMS; j++) {
+                int want = j == i ? val : before[j];
+                if (getPatchValue(s, j) != want && failures++ < 10) {
+                    printf("putPatchValue: param %d = %d, param %d reads %d, expected %d\n",
+                           i, val, j, getPatchValue(s, j), want);
+                }
+            }
+        }
+    }
+}
+
+// A full build, then every value of every parameter, against the old code.
+void checkRegisters(const patchSettings *s) {
+    livePatch p;
+    oldPatch o;
+    memset(&p, 0, sizeof(p));
+    memset(&o, 0, sizeof(o));
+    p.patch = *s;
+    for (int i = 0; i < PATCH_PARAMS; i++) o.v[i] = getPatchValue(s, i);
+
+    patchToRegisters(&p);
+    oldPatchToRegisters(&o);
+    compareRegisters("patchToRegisters", -1, 0, &p, &o);
+
+    for (int i = 0; i < PATCH_PARAMS; i++) {
+        for (int val = 0; val < ranges[i]; val++) {
+            putPatchValue(&p.patch, i, val);
+            patchUpdateRegisters(&p, patchParamRegisters(i));
+            o.v[i] = val;
+            oldPatchUpdateRegister(&o, i);
+            compareRegisters("patchUpdateRegisters", i, val, &p, &o);
+        }
+    }
+}
+
+// PATCH_VALUES and putPatchValue(), on random values of up to 16 bits.
+void checkPacking(int count) {
+    for (int n = 0; n < count; n++) {
+        int v[PATCH_PARAMS];
+        patchSettings s;
+        memset(&s, 0, sizeof(s));
+        for (int i = 0; i < PATCH_PARAMS; i++) {
+            v[i] = rand() & 0xFFFF;
+            putPatchValue(&s, i, v[i]);
+        }
+        const uint8_t packed[PATCH_VALUES_LEN] = PATCH_VALUES(
+            v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], v[9], v[10], v[11], v[12],
+            v[13], v[14], v[15], v[16], v[17], v[18], v[19], v[20], v[21], v[22], v[23],
+            v[24], v[25], v[26]);
+        for (int i = 0; i < PATCH_VALUES_LEN; i++) {
+            if (packed[i] != s.values[i] && failures++ < 10) {
+                printf("PATCH_VALUES: byte %d is 0x%02X, putPatchValue() gives 0x%02X\n",
+                       i, packed[i], s.values[i]);
+            }
+        }
+    }
+}
+
+struct factoryValues {
+    const char *name;
+    int v[PATCH_PARAMS];
+};
+
+#define FACTORY_VALUES(name, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, \
+        v14, v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26) \
+    {name, {v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, \
+        v14, v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26}},
+
+const factoryValues factory[] = {
+    FACTORY_BANK(FACTORY_VALUES)
+};
+
+// Each program plays its factory sound, the last (the initial patch) past
+// the end of them.
+void checkFactory() {
+    const int sounds = sizeof(factory) / sizeof(factory[0]);
+    for (int program = 0; program < PATCH_BANK_LEN; program++) {
+        const factoryValues *f = &factory[program < sounds - 1 ? program : sounds - 1];
+        patchSettings s;
+        loadFactoryPatch(program, &s);
+        if (strncmp(s.name, f->name, PATCHNAME_LEN) != 0 && failures++ < 10) {
+            printf("factory: program %d is %.8s, expected %s\n", program, s.name, f->name);
+        }
+        for (int i = 0; i < PATCH_PARAMS; i++) {
+            if (getPatchValue(&s, i) != f->v[i] && failures++ < 10) {
+                printf("factory: program %d (%s), param %d is %d, expected %d\n",
+                       program, f->name, i, getPatchValue(&s, i), f->v[i]);
+            }
+        }
+    }
+}
+
+// Save a random patch as a random program, and maybe wait for it to be
+// written, so loads come both from the EEPROM and from the queue.
+void saveRandomPatch(userBank *b) {
+    patchSettings s;
+    randomPatch(&s);
+    s.id = rand() % PATCH_BANK_LEN;
+    memcpy(s.name, "random", 7);
+    if (!saveUserPatch(b, &s)) {
+        while (userBankIdle(b)) delay(4);
+        saveUserPatch(b, &s);
+    }
+    if (rand() % 2) {
+        while (userBankIdle(b)) delay(4);
+    }
+}
+
+void checkIncremental(long steps) {
+    userBank user;
+    beginUserBank(&user);
+    for (int i = 0; i < 16; i++) saveRandomPatch(&user);
+
+    livePatch p;
+    memset(&p, 0, sizeof(p));
+    loadFactoryPatch(0, &p.patch);
+    patchToRegisters(&p);
+
+    for (long n = 0; n < steps; n++) {
+        int step = rand() % 10;
+        if (step < 7) {
+            int param = rand() % PATCH_PARAMS;
+            setPatchValue(&p, param, rand() % ranges[param]);
+        }
+        else {
+            patchSettings s;
+            uint8_t program = rand() % PATCH_BANK_LEN;
+            if (step == 9) saveRandomPatch(&user);
+            if (!loadUserPatch(&user, program, &s)) loadFactoryPatch(program, &s);
+            copyPatch(&s, &p);
+        }
+
+        livePatch full;
+        memset(&full, 0, sizeof(full));
+        full.patch = p.patch;
+        patchToRegisters(&full);
+        for (int r = 0; r < 25; r++) {
+            if (p.registers[r] != full.registers[r] && failures++ < 10) {
+                printf("incremental: step %ld, register %d is 0x%02X, a full build gives 0x%02X\n",
+                       n, r, p.registers[r], full.registers[r]);
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 200;
+    long steps = argc > 2 ? atol(argv[2]) : 100000;
+    srand(1);
+
+    checkParamRegisters();
+    for (int n = 0; n < count; n++) {
+        patchSettings s;
+        randomPatch(&s);
+        checkValues(&s);
+        randomPatch(&s);
+        checkRegisters(&s);
+    }
+
+    checkPacking(count * 100);
+    checkFactory();
+    checkIncremental(steps);
+
+    printf("%d random patches, every value of %d parameters, %ld incremental steps: %u mismatches\n",
+           count, PATCH_PARAMS, steps, failures);
+    return failures ? 1 : 0;
+}
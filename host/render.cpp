@@ -0,0 +1,33 @@
+#include "render.h"
+
+SidRenderer::SidRenderer(Sid6581 *pSids, unsigned int chips, WavWriter *pWav, double clockHz,
+                         unsigned long sampleRate)
+    : mSids(pSids), mChips(chips), mWav(pWav), mClockHz(clockHz),
+      mCyclesPerSample(clockHz / sampleRate), mNextSample(clockHz / sampleRate) {
+    for (unsigned int c = 0; c < chips; c++) mSids[c].setClock(clockHz);
+}
+
+void SidRenderer::renderTo(unsigned long micros) {
+    uint64_t target = (uint64_t)(micros * mClockHz / 1000000.0);
+
+    // The chips share a clock, so they all stand at the first one's cycle.
+    while (mSids[0].cycles() < target) {
+        uint64_t boundary = (uint64_t)mNextSample;
+        uint64_t end = target < boundary ? target : boundary;
+        unsigned int cycles = (unsigned int)(end - mSids[0].cycles());
+        for (unsigned int c = 0; c < mChips; c++) mSids[c].clock(cycles);
+        if (mSids[0].cycles() == boundary) {
+            int32_t s = 0;
+            for (unsigned int c = 0; c < mChips; c++) s += mSids[c].sample();
+            if (s > 32767) s = 32767;
+            if (s < -32768) s = -32768;
+            if (mWav) mWav->write((int16_t)s);
+            mNextSample += mCyclesPerSample;
+        }
+    }
+}
+
+void SidRenderer::write(unsigned long micros, uint8_t chip, uint8_t reg, uint8_t val) {
+    renderTo(micros);
+    if (chip < mChips) mSids[chip].write(reg, val);
+}
@@ -0,0 +1,37 @@
+/*
+ * Drives one or more Sid6581s from time stamped register writes and renders
+ * their output, mixed as the chips' outputs summed onto one line.
+ *
+ * Writes are applied at the chip cycle matching their time stamp, so the
+ * audio keeps the timing the firmware produced them with.
+ */
+#ifndef HOST_RENDER_H_
+#define HOST_RENDER_H_
+
+#include "sid.h"
+#include "wav.h"
+
+class SidRenderer {
+public:
+    // `chips` chips from `pSids`, clocked at `clockHz`. `pWav` may be NULL to
+    // run the chips without keeping the audio.
+    SidRenderer(Sid6581 *pSids, unsigned int chips, WavWriter *pWav, double clockHz,
+                unsigned long sampleRate);
+
+    // Render up to `micros` then apply the write to chip `chip`.
+    void write(unsigned long micros, uint8_t chip, uint8_t reg, uint8_t val);
+    // Render everything up to `micros`.
+    void renderTo(unsigned long micros);
+
+    double clockHz() const { return mClockHz; }
+
+private:
+    Sid6581 *mSids;
+    unsigned int mChips;
+    WavWriter *mWav;
+    double mClockHz;
+    double mCyclesPerSample;
+    double mNextSample;     // Chip cycle that completes the next sample.
+};
+
+#endif // HOST_RENDER_H_
@@ -0,0 +1,322 @@
+/*
+ * MIDI saturation benchmark.
+ *
+ * Runs the sketch's loop() against synthetic worst case streams, paced at
+ * the MIDI wire rate and then at multiples of it, and reports for each:
+ *
+ *  - the message rate offered and the rate handled by updatePerformance();
+ *  - messages dropped, and where: bytes overrun in the serial buffer,
+ *    messages the parser lost emptying a full buffer, events the event
+ *    queue had no room for;
+ *  - the latency from the last byte of a note or controller message
+ *    arriving to the end of the loop() pass that handled it, with a
+ *    histogram at the chosen rate.
+ *
+ * Multiples of the wire rate stand in for a slower CPU: a host that keeps up
+ * with 64 times the wire rate has 64 times the headroom of one that only
+ * just keeps up. So does -d, which adds virtual time to every pass. Each
+ * stream is finally run unpaced, for the most messages per second loop()
+ * can take. The streams are generated, so every run is the same.
+ *
+ *     host/satbench [-n messages] [-r rate] [-d us]
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "host.h"
+
+// The sketch itself, for its MIDI object, event queue and controller map.
+#include "../sidsystem.ino"
+
+// Host side
+
+namespace {
+
+struct stream {
+    const char *name;
+    std::vector<uint8_t> bytes;
+    // Index of the last byte of each measured message, by its event key.
+    std::map<uint32_t, size_t> lastByte;
+    unsigned long queued;   // Messages that reach the event queue.
+    uint8_t status;         // Running status of the generated bytes.
+    unsigned int counter;
+
+    stream(const char *n) : name(n), queued(0), status(0), counter(0) {}
+
+    static uint32_t key(uint8_t type, uint8_t data1, uint8_t data2) {
+        return (uint32_t)type << 16 | data1 << 8 | data2;
+    }
+
+    void channel(uint8_t type, uint8_t data1, uint8_t data2, bool measured) {
+        if (type != status) bytes.push_back(type);
+        status = type;
+        bytes.push_back(data1);
+        bytes.push_back(data2);
+        if (measured) lastByte[key(type & 0xF0, data1, data2)] = bytes.size() - 1;
+        queued++;
+    }
+
+    // Every controller has its own number and value, up to 120 * 128.
+    void cc() {
+        channel(0xB0, (counter / 128) % 120, counter % 128, true);
+        counter++;
+    }
+
+    // Note on with a velocity, so each one can be told apart. Returns the note.
+    uint8_t noteOn() {
+        uint8_t note = (counter / 127) % 128;
+        channel(0x90, note, counter % 127 + 1, true);
+        counter++;
+        return note;
+    }
+
+    void noteOff(uint8_t note) {
+        channel(0x90, note, 0, false);
+    }
+
+    // Program change, two bytes and one under running status.
+    void program() {
+        if (status != 0xC0) bytes.push_back(0xC0);
+        status = 0xC0;
+        bytes.push_back(counter % PROGRAMS_AVAILABLE);
+        queued++;
+        counter++;
+    }
+
+    void clock() {
+        bytes.push_back(0xF8);
+    }
+
+    // Universal non real time SysEx, which the sketch ignores.
+    void sysEx(int length) {
+        bytes.push_back(0xF0);
+        bytes.push_back(0x7E);
+        for (int i = 0; i < length - 3; i++) bytes.push_back(i & 0x7F);
+        bytes.push_back(0xF7);
+        status = 0;
+    }
+};
+
+class streamTransport : public HostTransport {
+public:
+    streamTransport(const std::vector<uint8_t> &bytes) : mBytes(bytes), mPos(0), mStart(0) {}
+
+    int receive(uint8_t *buf, int len) {
+        if (mPos == 0) mStart = hostMicros();
+        if (mPos == mBytes.size()) return -1;
+        int n = std::min((size_t)len, mBytes.size() - mPos);
+        std::copy(mBytes.begin() + mPos, mBytes.begin() + mPos + n, buf);
+        mPos += n;
+        return n;
+    }
+
+    bool continuous() const { return true; }
+
+    // When the first byte went on the wire.
+    unsigned long start() const { return mStart; }
+
+private:
+    const std::vector<uint8_t> &mBytes;
+    size_t mPos;
+    unsigned long mStart;
+};
+
+// Latency histogram bucket limits, in microseconds.
+const unsigned long bucketLimits[] = {50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000};
+const int buckets = sizeof(bucketLimits) / sizeof(bucketLimits[0]) + 1;
+
+struct result {
+    unsigned int rate;
+    double offered;         // Messages per second.
+    double handled;
+    unsigned long dropped;
+    unsigned long overrunBytes;
+    unsigned long parserLost;
+    unsigned long queueDropped;
+    std::vector<unsigned long> latencies;
+    unsigned long histogram[buckets];
+
+    unsigned long percentile(double p) const {
+        if (latencies.empty()) return 0;
+        return latencies[std::min(latencies.size() - 1, (size_t)(p * latencies.size()))];
+    }
+};
+
+// Extra virtual time per loop() pass.
+unsigned int passCost = 0;
+
+// Run `s` at `rate` times the wire rate, or unpaced if `rate` is 0.
+result run(const stream &s, unsigned int rate) {
+    result r;
+    r.rate = rate;
+    std::fill(r.histogram, r.histogram + buckets, 0);
+
+    streamTransport transport(s.bytes);
+    unsigned long baud = 31250UL * (rate ? rate : 1);
+    unsigned long byteTime = rate ? 10000000UL / baud : 0;  // As HardwareSerial paces.
+
+    unsigned long overruns = Serial.overruns();
+    midistats stats = MIDI.getInputStats();
+    uint16_t queueDropped = midiEvents.dropped;
+    unsigned long handled = 0;
+
+    Serial.attach(&transport);
+    Serial.begin(baud);
+    Serial.setPaced(rate != 0);
+
+    unsigned long end = 0;
+    while (!Serial.exhausted() || eventCount(&midiEvents) > 0) {
+        uint8_t tail = midiEvents.tail;
+        loop();
+        if (passCost) delayMicroseconds(passCost);
+        end = micros();
+
+        // The slots drained in this pass still hold their events.
+        for (uint8_t i = tail; i != midiEvents.tail; i++) {
+            const midiEvent &e = midiEvents.events[i & (EVENT_QUEUE_LEN - 1)];
+            handled++;
+            std::map<uint32_t, size_t>::const_iterator it = s.lastByte.find(stream::key(e.type, e.data1, e.data2));
+            if (it == s.lastByte.end()) continue;
+            unsigned long arrived = transport.start() + it->second * byteTime;
+            unsigned long latency = end > arrived ? end - arrived : 0;
+            r.latencies.push_back(latency);
+            int b = 0;
+            while (b < buckets - 1 && latency >= bucketLimits[b]) b++;
+            r.histogram[b]++;
+        }
+    }
+    std::sort(r.latencies.begin(), r.latencies.end());
+
+    double seconds = (end - transport.start()) / 1e6;
+    double wire = s.bytes.size() * byteTime / 1e6;
+    r.offered = wire > 0 ? s.queued / wire : 0;
+    r.handled = handled / (seconds > wire ? seconds : wire);
+    r.dropped = s.queued > handled ? s.queued - handled : 0;
+    r.overrunBytes = Serial.overruns() - overruns;
+    r.parserLost = MIDI.getInputStats().messagesLost - stats.messagesLost;
+    r.queueDropped = (uint16_t)(midiEvents.dropped - queueDropped);
+    return r;
+}
+
+void printHistogram(const result &r) {
+    unsigned long most = *std::max_element(r.histogram, r.histogram + buckets);
+    for (int b = 0; b < buckets; b++) {
+        char label[32];
+        if (b < buckets - 1) snprintf(label, sizeof(label), "< %lu us", bucketLimits[b]);
+        else snprintf(label, sizeof(label), ">= %lu us", bucketLimits[b - 1]);
+        int bar = most ? (int)(r.histogram[b] * 40 / most) : 0;
+        printf("    %-12s %7lu %s\n", label, r.histogram[b], std::string(bar, '#').c_str());
+    }
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [-n messages] [-r rate] [-d us]\n"
+        "\n"
+        "  -n N    note and controller messages per stream (default 1000)\n"
+        "  -r X    only run at X times the wire rate, with histograms (default:\n"
+        "          a ramp from 1 to 256, with histograms at 1)\n"
+        "  -d US   add US microseconds to every loop() pass\n",
+        name);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    unsigned int count = 1000;
+    unsigned int onlyRate = 0;
+    int c;
+    while ((c = getopt(argc, argv, "n:r:d:h")) != -1) {
+        switch (c) {
+            case 'd': passCost = strtoul(optarg, NULL, 10); break;
+            case 'n': count = strtoul(optarg, NULL, 10); break;
+            case 'r': onlyRate = strtoul(optarg, NULL, 10); break;
+            default: usage(argv[0]); return c == 'h' ? 0 : 2;
+        }
+    }
+    if (count == 0 || count > 120 * 128) count = 1000;
+
+    std::vector<stream> streams;
+
+    stream cc("dense cc");
+    for (unsigned int i = 0; i < count; i++) cc.cc();
+    streams.push_back(cc);
+
+    stream notes("note flurry");
+    for (unsigned int i = 0; i < count; i++) notes.noteOff(notes.noteOn());
+    streams.push_back(notes);
+
+    stream clocked("cc + clock");
+    for (unsigned int i = 0; i < count; i++) {
+        clocked.cc();
+        clocked.clock();
+    }
+    streams.push_back(clocked);
+
+    // One data byte a message, so each byte read can be an event.
+    stream programs("dense program");
+    for (unsigned int i = 0; i < count; i++) programs.program();
+    streams.push_back(programs);
+
+    stream sysex("sysex bursts");
+    for (unsigned int i = 0; i < count; i++) {
+        if (i % 8 == 0) sysex.sysEx(48);
+        sysex.cc();
+    }
+    streams.push_back(sysex);
+
+    stream mixed("mixed");
+    for (unsigned int i = 0; i < count; ) {
+        uint8_t held[4];
+        for (int n = 0; n < 4 && i < count; n++, i++) held[n] = mixed.noteOn();
+        for (int n = 0; n < 8 && i < count; n++, i++) mixed.cc();
+        mixed.clock();
+        for (int n = 0; n < 4; n++) mixed.noteOff(held[n]);
+        if (i % 64 < 16) mixed.sysEx(32);
+    }
+    streams.push_back(mixed);
+
+    setup();
+    // Give every controller a parameter, so each one reaches the SID.
+    for (int i = 0; i < 120; i++) midiAssignments[i] = i % 27;
+
+    std::vector<unsigned int> rates;
+    if (onlyRate) rates.push_back(onlyRate);
+    else for (unsigned int rate = 1; rate <= 256; rate *= 2) rates.push_back(rate);
+
+    printf("%-13s %5s %10s %10s %8s %8s %7s %7s %8s %8s %8s\n", "stream", "rate",
+           "offered/s", "handled/s", "dropped", "overrun", "parser", "queue", "p50 us", "p99 us", "max us");
+    int failed = 0;
+    std::vector<result> detail;
+    for (size_t i = 0; i < streams.size(); i++) {
+        unsigned int keepsUp = 0;
+        for (size_t j = 0; j < rates.size(); j++) {
+            result r = run(streams[i], rates[j]);
+            printf("%-13s %4ux %10.0f %10.0f %8lu %8lu %7lu %7lu %8lu %8lu %8lu\n", streams[i].name,
+                   r.rate, r.offered, r.handled, r.dropped, r.overrunBytes, r.parserLost, r.queueDropped,
+                   r.percentile(0.5), r.percentile(0.99), r.latencies.empty() ? 0 : r.latencies.back());
+            if (r.dropped == 0 && r.overrunBytes == 0 && keepsUp == j) keepsUp = j + 1;
+            if (j == 0) detail.push_back(r);
+        }
+        if (rates.size() > 1) {
+            if (keepsUp) printf("%-13s keeps up to %ux the wire rate\n", "", rates[keepsUp - 1]);
+            else printf("%-13s drops at the wire rate\n", "");
+        }
+        result flat = run(streams[i], 0);
+        printf("%-13s unpaced: %.0f msg/s, %.0fx the wire rate\n", "", flat.handled,
+               flat.handled / detail.back().offered);
+        if (rates[0] == 1 && detail.back().dropped) failed = 1;
+    }
+
+    for (size_t i = 0; i < detail.size(); i++) {
+        printf("\n%s at %ux, latency over %lu messages:\n", streams[i].name, detail[i].rate,
+               (unsigned long)detail[i].latencies.size());
+        printHistogram(detail[i]);
+    }
+    return failed;
+}
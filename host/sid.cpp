@@ -0,0 +1,238 @@
+#include <math.h>
+#include <string.h>
+#include "sid.h"
+
+// Envelope rate counter periods, in cycles per step, for rate nibbles 0-15.
+// Decay and release use the same table, then divide further by the
+// exponential counter below.
+static const uint16_t ratePeriod[16] = {
+    9, 32, 63, 95, 149, 220, 267, 313, 392, 977, 1954, 3126, 3907, 11720, 19532, 31251
+};
+
+// Extra division applied to decay/release steps as the envelope falls,
+// giving the chip's piecewise exponential curve.
+static uint8_t expPeriod(uint8_t env) {
+    if (env >= 0x5D) return 1;
+    if (env >= 0x36) return 2;
+    if (env >= 0x1A) return 4;
+    if (env >= 0x0E) return 8;
+    if (env >= 0x06) return 16;
+    return 30;
+}
+
+Sid6581::Sid6581() : mClockHz(1000000.0) {
+    reset();
+}
+
+void Sid6581::reset() {
+    memset(mVoice, 0, sizeof(mVoice));
+    memset(mRegs, 0, sizeof(mRegs));
+    for (int i = 0; i < 3; i++) {
+        mVoice[i].noise = 0x7FFFF8;
+        mVoice[i].state = Release;
+        mVoice[i].holdZero = true;
+    }
+    mCycle = 0;
+    mLp = mBp = 0;
+    mW = 0;
+    mDamp = 1.414f;
+    mSum = 0;
+    mSumCycles = 0;
+    memset(&mLatency, 0, sizeof(mLatency));
+    mLatency.min = UINT32_MAX;
+}
+
+void Sid6581::write(uint8_t reg, uint8_t val) {
+    if (reg > 24) return;
+    mRegs[reg] = val;
+
+    if (reg < 21) {
+        voice &v = mVoice[reg / 7];
+        switch (reg % 7) {
+            case 0: v.freq = (v.freq & 0xFF00) | val; break;
+            case 1: v.freq = (v.freq & 0x00FF) | (val << 8); break;
+            case 2: v.pw = (v.pw & 0xF00) | val; break;
+            case 3: v.pw = (v.pw & 0x0FF) | ((val & 0xF) << 8); break;
+            case 4: {
+                bool gate = val & 0x1;
+                if (gate && !(v.control & 0x1)) {
+                    v.state = Attack;
+                    v.holdZero = false;
+                    v.waiting = true;
+                    v.gateCycle = mCycle;
+                }
+                else if (!gate && (v.control & 0x1)) {
+                    v.state = Release;
+                    v.waiting = false;
+                }
+                // The test bit holds the oscillator (and noise) in reset.
+                if (val & 0x8) {
+                    v.acc = 0;
+                    v.noise = 0x7FFFF8;
+                }
+                v.control = val;
+                break;
+            }
+            case 5: v.attack = val >> 4; v.decay = val & 0xF; break;
+            case 6: v.sustain = val >> 4; v.release = val & 0xF; break;
+        }
+        return;
+    }
+
+    updateFilter();
+}
+
+void Sid6581::setClock(double hz) {
+    mClockHz = hz;
+    updateFilter();
+}
+
+void Sid6581::updateFilter() {
+    // Filter cutoff is 11 bits across registers 21 (low 3) and 22 (high 8).
+    // The 6581 curve is roughly linear from 30Hz to 12kHz.
+    unsigned int fc = (mRegs[21] & 0x7) | (mRegs[22] << 3);
+    float hz = 30.0f + fc * 5.8f;
+    // Integrated once a cycle, so the coefficient scales with the clock.
+    mW = 2.0f * (float)M_PI * hz / (float)mClockHz;
+    // Resonance from the top nibble of 23: Q of 0.707 up to about 2.6.
+    mDamp = 1.0f / (0.707f + (mRegs[23] >> 4) / 8.0f);
+}
+
+void Sid6581::clockEnvelope(voice &v) {
+    uint8_t rate;
+    if (v.state == Attack) rate = v.attack;
+    else if (v.state == DecaySustain) rate = v.decay;
+    else rate = v.release;
+
+    // The counter is compared for equality, so lowering the rate while the
+    // counter is already past the new period wraps the full 15 bits first.
+    v.rateCounter = (v.rateCounter + 1) & 0x7FFF;
+    if (v.rateCounter != ratePeriod[rate]) return;
+    v.rateCounter = 0;
+
+    if (v.state == Attack) {
+        v.expCounter = 0;
+        if (v.env != 0xFF) v.env++;
+        if (v.env == 0xFF) v.state = DecaySustain;
+        return;
+    }
+
+    if (++v.expCounter < expPeriod(v.env)) return;
+    v.expCounter = 0;
+    if (v.holdZero) return;
+
+    if (v.state == DecaySustain) {
+        if (v.env > v.sustain * 0x11) v.env--;
+    }
+    else if (v.env > 0) {
+        v.env--;
+    }
+    if (v.env == 0) v.holdZero = true;
+}
+
+// 12 bit waveform output of voice i for the current cycle.
+int Sid6581::waveOutput(int i) const {
+    const voice &v = mVoice[i];
+    const voice &src = mVoice[(i + 2) % 3];
+    uint8_t wave = v.control >> 4;
+    int out = 0xFFF;
+
+    if (wave == 0) return 0;
+    if (wave & 0x1) {
+        // Triangle, with ring modulation replacing the MSB by XOR with the
+        // sync source's.
+        uint32_t msb = v.acc & 0x800000;
+        if (v.control & 0x4) msb ^= src.acc & 0x800000;
+        out &= ((msb ? ~v.acc : v.acc) >> 11) & 0xFFF;
+    }
+    if (wave & 0x2) out &= v.acc >> 12;
+    if (wave & 0x4) out &= ((v.acc >> 12) >= v.pw || (v.control & 0x8)) ? 0xFFF : 0;
+    if (wave & 0x8) {
+        uint32_t n = v.noise;
+        out &= ((n & 0x400000) >> 11) | ((n & 0x100000) >> 10) | ((n & 0x010000) >> 7) |
+               ((n & 0x002000) >> 5) | ((n & 0x000800) >> 4) | ((n & 0x000080) >> 1) |
+               ((n & 0x000010) << 1) | ((n & 0x000004) << 2);
+    }
+    return out;
+}
+
+void Sid6581::clockOne() {
+    for (int i = 0; i < 3; i++) {
+        voice &v = mVoice[i];
+        if (v.control & 0x8) {
+            v.msbRising = false;
+            continue;
+        }
+        uint32_t prev = v.acc;
+        v.acc = (v.acc + v.freq) & 0xFFFFFF;
+        v.msbRising = !(prev & 0x800000) && (v.acc & 0x800000);
+        // Noise is clocked by bit 19 of the accumulator.
+        if (!(prev & 0x080000) && (v.acc & 0x080000)) {
+            uint32_t bit = ((v.noise >> 22) ^ (v.noise >> 17)) & 0x1;
+            v.noise = ((v.noise << 1) | bit) & 0x7FFFFF;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        voice &v = mVoice[i];
+        if ((v.control & 0x2) && mVoice[(i + 2) % 3].msbRising) v.acc = 0;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        voice &v = mVoice[i];
+        clockEnvelope(v);
+        if (v.waiting && v.env > 0) {
+            v.waiting = false;
+            if (mRegs[24] & 0xF) {
+                uint32_t d = (uint32_t)(mCycle - v.gateCycle);
+                mLatency.count++;
+                mLatency.total += d;
+                if (d < mLatency.min) mLatency.min = d;
+                if (d > mLatency.max) mLatency.max = d;
+            }
+        }
+    }
+    mCycle++;
+}
+
+void Sid6581::clock(unsigned int cycles) {
+    const uint8_t route = mRegs[23] & 0x7;
+    const uint8_t mode = mRegs[24];
+    const float volume = (mRegs[24] & 0xF) / 15.0f;
+
+    for (unsigned int c = 0; c < cycles; c++) {
+        clockOne();
+
+        float direct = 0;
+        float filtered = 0;
+        for (int i = 0; i < 3; i++) {
+            // Signed waveform times envelope: +-2048 * 255.
+            float s = (float)(waveOutput(i) - 0x800) * mVoice[i].env;
+            if (route & (1 << i)) filtered += s;
+            // 3OFF mutes voice 3 unless it is routed through the filter.
+            else if (i != 2 || !(mode & 0x80)) direct += s;
+        }
+
+        // State variable filter, integrated at the chip clock.
+        float hp = filtered - mLp - mDamp * mBp;
+        mBp += mW * hp;
+        mLp += mW * mBp;
+
+        float out = direct;
+        if (mode & 0x10) out += mLp;
+        if (mode & 0x20) out += mBp;
+        if (mode & 0x40) out += hp;
+        mSum += out * volume;
+    }
+    mSumCycles += cycles;
+}
+
+int16_t Sid6581::sample() {
+    if (mSumCycles == 0) return 0;
+    // Three full scale voices map to full scale output.
+    float v = mSum / mSumCycles / (3.0f * 2048.0f * 255.0f) * 32767.0f;
+    mSum = 0;
+    mSumCycles = 0;
+    if (v > 32767.0f) v = 32767.0f;
+    if (v < -32768.0f) v = -32768.0f;
+    return (int16_t)v;
+}
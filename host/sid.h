@@ -0,0 +1,92 @@
+/*
+ * Software MOS 6581.
+ *
+ * Cycle stepped model of the three oscillators (including hard sync, ring
+ * modulation and the noise LFSR), the ADSR envelope generators (including
+ * the rate counter quirk that can delay an attack by up to 32768 cycles) and
+ * the multimode filter. Registers 0-24 behave as on the chip; the read-only
+ * registers 25-28 are not modelled.
+ */
+#ifndef HOST_SID_H_
+#define HOST_SID_H_
+
+#include <inttypes.h>
+
+class Sid6581 {
+public:
+    Sid6581();
+
+    void reset();
+    void write(uint8_t reg, uint8_t val);
+    uint8_t registerValue(uint8_t reg) const { return reg < 32 ? mRegs[reg] : 0; }
+
+    // The rate clock() is driven at, for the filter cutoff. 1MHz unless set.
+    void setClock(double hz);
+
+    // Run the chip for `cycles` clocks.
+    void clock(unsigned int cycles);
+
+    // Mean output since the previous call, as a signed 16 bit sample.
+    int16_t sample();
+
+    // Elapsed chip clocks since reset.
+    uint64_t cycles() const { return mCycle; }
+
+    // Gate-on to audible latency: from the write that sets a voice's gate bit
+    // to the first cycle its envelope leaves zero. Only counted while the
+    // master volume is non-zero.
+    struct latency {
+        unsigned long count;
+        uint64_t total;
+        uint32_t min;
+        uint32_t max;
+    };
+    const latency &gateLatency() const { return mLatency; }
+
+private:
+    enum envState { Attack, DecaySustain, Release };
+
+    struct voice {
+        uint32_t acc;       // 24 bit phase accumulator
+        uint32_t noise;     // 23 bit LFSR
+        bool msbRising;     // Accumulator MSB went high this cycle (sync source)
+        uint16_t freq;
+        uint16_t pw;        // 12 bit
+        uint8_t control;
+        uint8_t attack;
+        uint8_t decay;
+        uint8_t sustain;
+        uint8_t release;
+
+        envState state;
+        uint8_t env;
+        uint16_t rateCounter; // 15 bit
+        uint8_t expCounter;
+        bool holdZero;
+        bool waiting;         // Gate set, envelope not yet audible
+        uint64_t gateCycle;
+    };
+
+    void clockOne();
+    int waveOutput(int i) const;
+    void clockEnvelope(voice &v);
+    void updateFilter();
+
+    voice mVoice[3];
+    uint8_t mRegs[32];
+    uint64_t mCycle;
+    double mClockHz;
+
+    // Filter state, integrated per cycle.
+    float mLp;
+    float mBp;
+    float mW;      // 2 * pi * fc / clock
+    float mDamp;   // 1 / Q
+
+    float mSum;    // Output accumulated for the next sample.
+    unsigned long mSumCycles;
+
+    latency mLatency;
+};
+
+#endif // HOST_SID_H_
@@ -0,0 +1,217 @@
+/*
+ * Reads a SID register trace (see sidtrace.h), as recorded by
+ * `sidsystem-host --trace` or a SID_TRACE build of the sketch.
+ *
+ * By default every write is printed, one a line, with the chip it went to,
+ * so two traces can be
+ * compared with diff(1). It can also summarise the trace, render it through
+ * the software SID to a WAV file, or replay it onto the bus: through the
+ * sidbus.h backend on the pin stand-ins, decoding each write back off the
+ * pins and counting the AVR cycles the bus took.
+ *
+ *     host/sidreplay [-t] [-s] [-b] [-w out.wav] trace
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "Arduino.h"
+#include "host.h"
+#include "render.h"
+#include "sid.h"
+#include "wav.h"
+#include "../sidbus.h"
+#include "../sidtrace.h"
+
+namespace {
+
+const char *const regNames[25] = {
+    "FRELO1", "FREHI1", "PWLO1", "PWHI1", "CR1", "AD1", "SR1",
+    "FRELO2", "FREHI2", "PWLO2", "PWHI2", "CR2", "AD2", "SR2",
+    "FRELO3", "FREHI3", "PWLO3", "PWHI3", "CR3", "AD3", "SR3",
+    "FCLO", "FCHI", "RESFILT", "MODEVOL",
+};
+
+const char *regName(uint8_t reg) {
+    return reg < 25 ? regNames[reg] : "?";
+}
+
+bool load(const char *path, std::vector<uint8_t> *pBytes) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return false;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) pBytes->insert(pBytes->end(), buf, buf + n);
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+void print(const std::vector<sidTraceRecord> &writes, bool times) {
+    for (size_t i = 0; i < writes.size(); i++) {
+        const sidTraceRecord &w = writes[i];
+        if (times) printf("%10lu ", w.time);
+        printf("%u %2u %-8s %02X\n", w.chip, w.reg, regName(w.reg), w.val);
+    }
+}
+
+void summarise(const std::vector<sidTraceRecord> &writes) {
+    unsigned long perReg[32] = {0};
+    unsigned long repeats[32] = {0};
+    unsigned long perChip[4] = {0};
+    int last[4][32];
+    std::fill(last[0], last[0] + 4 * 32, -1);
+    unsigned long ticks = 0, busiest = 0, run = 0;
+    for (size_t i = 0; i < writes.size(); i++) {
+        const sidTraceRecord &w = writes[i];
+        perReg[w.reg]++;
+        perChip[w.chip]++;
+        if (last[w.chip][w.reg] == w.val) repeats[w.reg]++;
+        last[w.chip][w.reg] = w.val;
+        if (i == 0 || w.time != writes[i - 1].time) {
+            ticks++;
+            run = 0;
+        }
+        busiest = std::max(busiest, ++run);
+    }
+    double span = writes.size() > 1 ? (writes.back().time - writes.front().time) / 1e6 : 0;
+    printf("writes          %lu\n", (unsigned long)writes.size());
+    printf("span            %.3f s\n", span);
+    if (span > 0) printf("rate            %.0f writes/s\n", writes.size() / span);
+    printf("write times     %lu, at most %lu writes at one\n", ticks, busiest);
+    printf("chip writes    ");
+    for (int c = 0; c < 4; c++) printf(" %lu", perChip[c]);
+    printf("\n");
+    printf("\n%-3s %-8s %8s %8s\n", "reg", "name", "writes", "repeats");
+    for (int r = 0; r < 32; r++) {
+        if (perReg[r]) printf("%-3d %-8s %8lu %8lu\n", r, regName(r), perReg[r], repeats[r]);
+    }
+}
+
+std::vector<sidTraceRecord> decoded;
+unsigned long decodeTime;
+
+void onBusWrite(uint8_t chip, uint8_t reg, uint8_t val) {
+    sidTraceRecord w = {decodeTime, chip, reg, val};
+    decoded.push_back(w);
+}
+
+// Replay onto the bus. Returns false if what comes off the pins differs.
+bool replayBus(const std::vector<sidTraceRecord> &writes) {
+    hostSetSidWriteHandler(onBusWrite);
+    sidBus::begin();
+    uint64_t start = hostCycles(), tickStart = start, busiest = 0;
+    for (size_t i = 0; i < writes.size(); i++) {
+        if (i > 0 && writes[i].time != writes[i - 1].time) tickStart = hostCycles();
+        decodeTime = writes[i].time;
+        sidBus::write(writes[i].chip, writes[i].reg, writes[i].val);
+        busiest = std::max(busiest, hostCycles() - tickStart);
+    }
+    uint64_t cycles = hostCycles() - start;
+    bool same = decoded.size() == writes.size();
+    for (size_t i = 0; same && i < writes.size(); i++) {
+        same = decoded[i].chip == writes[i].chip && decoded[i].reg == writes[i].reg
+            && decoded[i].val == writes[i].val;
+    }
+    fprintf(stderr, "bus cycles      %llu, %.1f a write\n", (unsigned long long)cycles,
+            writes.empty() ? 0.0 : (double)cycles / writes.size());
+    fprintf(stderr, "busiest time    %llu cycles (%.1f us)\n", (unsigned long long)busiest, busiest / 16.0);
+    fprintf(stderr, "bus decode      %s\n", same ? "matches" : "MISMATCH");
+    return same;
+}
+
+bool render(const std::vector<sidTraceRecord> &writes, uint32_t clockHz, const char *path,
+            unsigned long sampleRate, double tail) {
+    WavWriter wav;
+    if (!wav.open(path, sampleRate)) {
+        perror(path);
+        return false;
+    }
+    Sid6581 sids[4];
+    unsigned int chips = 1;
+    for (size_t i = 0; i < writes.size(); i++) chips = std::max(chips, writes[i].chip + 1U);
+    SidRenderer renderer(sids, chips, &wav, clockHz, sampleRate);
+    for (size_t i = 0; i < writes.size(); i++) {
+        renderer.write(writes[i].time, writes[i].chip, writes[i].reg, writes[i].val);
+    }
+    renderer.renderTo((writes.empty() ? 0 : writes.back().time) + (unsigned long)(tail * 1e6));
+    fprintf(stderr, "WAV samples     %lu (%.2f s)\n", wav.samples(), (double)wav.samples() / sampleRate);
+    wav.close();
+    return true;
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [options] trace\n"
+        "\n"
+        "Prints the register writes in a SID trace, one a line.\n"
+        "\n"
+        "  -t          leave out the times, to compare runs whose timing differs\n"
+        "  -s          print a summary instead: rates and writes per register\n"
+        "  -b          replay onto the bus (sidbus.h) and report its cost; with -w\n"
+        "              the writes rendered are those decoded off the pins\n"
+        "  -w FILE     render the writes through the software SID to a WAV file\n"
+        "  -r HZ       WAV sample rate (default 44100)\n"
+        "  -a N        render N seconds after the last write (default 1)\n",
+        name);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    bool times = true;
+    bool summary = false;
+    bool bus = false;
+    const char *wavPath = NULL;
+    unsigned long sampleRate = 44100;
+    double tail = 1.0;
+    int c;
+    while ((c = getopt(argc, argv, "tsbw:r:a:h")) != -1) {
+        switch (c) {
+            case 't': times = false; break;
+            case 's': summary = true; break;
+            case 'b': bus = true; break;
+            case 'w': wavPath = optarg; break;
+            case 'r': sampleRate = strtoul(optarg, NULL, 10); break;
+            case 'a': tail = atof(optarg); break;
+            default: usage(argv[0]); return c == 'h' ? 0 : 2;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const char *path = argv[optind];
+    std::vector<uint8_t> bytes;
+    if (!load(path, &bytes)) {
+        perror(path);
+        return 1;
+    }
+    uint32_t clockHz;
+    int pos = readSidTraceHeader(bytes.data(), bytes.size(), &clockHz);
+    if (pos == 0) {
+        fprintf(stderr, "%s: not a SID trace\n", path);
+        return 1;
+    }
+    std::vector<sidTraceRecord> writes;
+    sidTraceRecord w = {0, 0, 0, 0};
+    while ((size_t)pos < bytes.size()) {
+        int n = readSidTraceRecord(bytes.data() + pos, bytes.size() - pos, &w);
+        if (n == 0) {
+            fprintf(stderr, "%s: bad record at offset %d, stopping there\n", path, pos);
+            break;
+        }
+        writes.push_back(w);
+        pos += n;
+    }
+
+    int status = 0;
+    if (bus && !replayBus(writes)) status = 1;
+    const std::vector<sidTraceRecord> &played = bus ? decoded : writes;
+    if (wavPath && !render(played, clockHz, wavPath, sampleRate, tail)) status = 1;
+    if (summary) summarise(played);
+    else if (!bus && !wavPath) print(played, times);
+    return status;
+}
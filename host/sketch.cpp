@@ -0,0 +1,3 @@
+// The Arduino IDE compiles the sketch as C++ with Arduino.h included first.
+#include "Arduino.h"
+#include "../sidsystem.ino"
@@ -0,0 +1,261 @@
+#include <string.h>
+#include <unistd.h>
+#include "host.h"
+#include "smf.h"
+
+static uint32_t bigEndian(const uint8_t *p, int len) {
+    uint32_t v = 0;
+    while (len--) v = v << 8 | *p++;
+    return v;
+}
+
+SmfTransport::SmfTransport(FILE *pFile, uint16_t division)
+    : mFile(pFile), mOutFd(-1), mDivision(division), mTempo(500000),
+      mBaseTick(0), mBaseTime(0), mSmpte(false), mFast(false), mScale(1.0),
+      mStarted(false), mStart(0), mPrefixLen(0), mPrefixPos(0), mCopy(0),
+      mCurrent(-1), mOutStatus(0), mLastTime(0), mMessages(0) {
+    if (division & 0x8000) {
+        // Frames per second (as a negative number) and ticks per frame.
+        int fps = 256 - (division >> 8);
+        mSmpte = true;
+        mDivision = division & 0xFF;
+        mTempo = 1000000 / fps;
+    }
+    if (mDivision == 0) mDivision = 1;
+}
+
+SmfTransport::~SmfTransport() {
+    fclose(mFile);
+}
+
+SmfTransport *SmfTransport::open(const char *path, const char **pError) {
+    *pError = NULL;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+
+    uint8_t header[14];
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header, "MThd", 4) != 0) {
+        fclose(f);
+        return NULL;
+    }
+    uint32_t length = bigEndian(header + 4, 4);
+    uint16_t format = bigEndian(header + 8, 2);
+    uint16_t tracks = bigEndian(header + 10, 2);
+    if (length < 6) {
+        *pError = "bad MThd chunk";
+        fclose(f);
+        return NULL;
+    }
+    if (format > 1) {
+        *pError = "only type 0 and 1 files can be played";
+        fclose(f);
+        return NULL;
+    }
+
+    SmfTransport *pSmf = new SmfTransport(f, bigEndian(header + 12, 2));
+    long pos = 8 + length;
+    while (pSmf->mTracks.size() < tracks) {
+        uint8_t chunk[8];
+        if (fseek(f, pos, SEEK_SET) != 0 || fread(chunk, 1, sizeof(chunk), f) != sizeof(chunk)) break;
+        length = bigEndian(chunk + 4, 4);
+        pos += sizeof(chunk);
+        // Chunks other than MTrk are skipped, as the standard asks.
+        if (memcmp(chunk, "MTrk", 4) == 0) {
+            track t;
+            memset(&t, 0, sizeof(t));
+            t.pos = pos;
+            t.end = pos + length;
+            pSmf->mTracks.push_back(t);
+        }
+        pos += length;
+    }
+    if (pSmf->mTracks.empty()) {
+        *pError = "no tracks";
+        delete pSmf;
+        return NULL;
+    }
+    for (size_t i = 0; i < pSmf->mTracks.size(); i++) pSmf->readEvent(pSmf->mTracks[i]);
+    return pSmf;
+}
+
+// Next byte of a track, or -1 at its end. Reads from the file a buffer at a
+// time, so only a few bytes per track are ever held.
+int SmfTransport::nextByte(track &t) {
+    if (t.bufPos == t.bufLen) {
+        if (t.pos >= t.end) return -1;
+        long n = t.end - t.pos;
+        if (n > (long)sizeof(t.buf)) n = sizeof(t.buf);
+        if (fseek(mFile, t.pos, SEEK_SET) != 0) return -1;
+        t.bufLen = fread(t.buf, 1, n, mFile);
+        t.bufPos = 0;
+        if (t.bufLen <= 0) {
+            t.pos = t.end;
+            t.bufLen = 0;
+            return -1;
+        }
+        t.pos += t.bufLen;
+    }
+    return t.buf[t.bufPos++];
+}
+
+bool SmfTransport::readVarLen(track &t, uint32_t *pValue) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        int b = nextByte(t);
+        if (b < 0) return false;
+        v = v << 7 | (b & 0x7F);
+        if (!(b & 0x80)) {
+            *pValue = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SmfTransport::skip(track &t, uint32_t count) {
+    while (count--) {
+        if (nextByte(t) < 0) return;
+    }
+}
+
+// Read the header of the track's next event, leaving `remaining` bytes of
+// SysEx or meta data in the file. A malformed track just ends.
+void SmfTransport::readEvent(track &t) {
+    uint32_t delta;
+    t.kind = kEnd;
+    t.remaining = 0;
+    if (!readVarLen(t, &delta)) return;
+
+    int b = nextByte(t);
+    if (b < 0) return;
+    int first = -1;
+    if (b < 0x80) {
+        // Running status: this is the first data byte.
+        if (t.runningStatus == 0) return;
+        first = b;
+        b = t.runningStatus;
+    }
+
+    if (b < 0xF0) {
+        t.runningStatus = b;
+        t.status = b;
+        int count = ((b & 0xF0) == 0xC0 || (b & 0xF0) == 0xD0) ? 1 : 2;
+        for (int i = 0; i < count; i++) {
+            int d = (i == 0 && first >= 0) ? first : nextByte(t);
+            if (d < 0 || d >= 0x80) return;
+            t.data[i] = d;
+        }
+        t.kind = kChannel;
+    }
+    else if (b == 0xF0 || b == 0xF7) {
+        // SysEx and meta events cancel running status.
+        t.runningStatus = 0;
+        if (!readVarLen(t, &t.remaining)) return;
+        t.kind = b == 0xF0 ? kSysEx : kEscape;
+    }
+    else if (b == 0xFF) {
+        t.runningStatus = 0;
+        int type = nextByte(t);
+        if (type < 0 || !readVarLen(t, &t.remaining)) return;
+        if (type == 0x2F) return;   // End of Track.
+        t.metaType = type;
+        t.kind = kMeta;
+    }
+    else {
+        return;
+    }
+    t.tick += delta;
+}
+
+uint64_t SmfTransport::timeOf(uint32_t tick) const {
+    return mBaseTime + (uint64_t)(tick - mBaseTick) * mTempo / mDivision;
+}
+
+// Set up the next message to deliver. Returns 1 once one is ready, 0 if it
+// isn't due yet and -1 at the end of every track.
+int SmfTransport::startNext() {
+    for (;;) {
+        int next = -1;
+        for (size_t i = 0; i < mTracks.size(); i++) {
+            if (mTracks[i].kind == kEnd) continue;
+            if (next < 0 || mTracks[i].tick < mTracks[next].tick) next = i;
+        }
+        if (next < 0) return -1;
+        track &t = mTracks[next];
+
+        uint64_t time = timeOf(t.tick);
+        if (!mFast && hostMicros() - mStart < (unsigned long)(time / mScale)) return 0;
+
+        if (t.kind == kMeta) {
+            if (t.metaType == 0x51 && t.remaining == 3) {
+                uint8_t tempo[3];
+                for (int i = 0; i < 3; i++) tempo[i] = nextByte(t);
+                if (!mSmpte) {
+                    mBaseTime = time;
+                    mBaseTick = t.tick;
+                    mTempo = bigEndian(tempo, 3);
+                }
+            }
+            else {
+                skip(t, t.remaining);
+            }
+            readEvent(t);
+            continue;
+        }
+
+        mPrefixLen = mPrefixPos = 0;
+        mCopy = 0;
+        if (t.kind == kChannel) {
+            if (t.status != mOutStatus) mPrefix[mPrefixLen++] = t.status;
+            mOutStatus = t.status;
+            mPrefix[mPrefixLen++] = t.data[0];
+            if ((t.status & 0xF0) != 0xC0 && (t.status & 0xF0) != 0xD0) mPrefix[mPrefixLen++] = t.data[1];
+            readEvent(t);
+        }
+        else {
+            if (t.kind == kSysEx) mPrefix[mPrefixLen++] = 0xF0;
+            mOutStatus = 0;
+            mCopy = t.remaining;
+            mCurrent = next;
+            if (mCopy == 0) readEvent(t);
+        }
+        mLastTime = time;
+        mMessages++;
+        return 1;
+    }
+}
+
+int SmfTransport::receive(uint8_t *buf, int len) {
+    if (!mStarted) {
+        mStart = hostMicros();
+        mStarted = true;
+    }
+
+    int n = 0;
+    while (n < len) {
+        if (mPrefixPos < mPrefixLen) {
+            buf[n++] = mPrefix[mPrefixPos++];
+        }
+        else if (mCopy > 0) {
+            track &t = mTracks[mCurrent];
+            int b = nextByte(t);
+            if (b < 0) {
+                mCopy = 0;
+                t.kind = kEnd;
+                continue;
+            }
+            buf[n++] = b;
+            if (--mCopy == 0) readEvent(t);
+        }
+        else {
+            int r = startNext();
+            if (r == 0) break;
+            if (r < 0) return n ? n : -1;
+        }
+    }
+    return n;
+}
+
+void SmfTransport::transmit(uint8_t b) {
+    if (mOutFd >= 0 && ::write(mOutFd, &b, 1) != 1) mOutFd = -1;
+}
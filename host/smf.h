@@ -0,0 +1,111 @@
+/*
+ * Standard MIDI File player for the host serial port.
+ *
+ * Type 0 and type 1 files are streamed from disk a few bytes at a time: each
+ * track keeps its read position and a small buffer, and the tracks are merged
+ * by time as they are played. The bytes delivered depend only on the file,
+ * so every run feeds the sketch exactly the same stream:
+ *
+ *  - channel messages in time order, ties going to the lower track, with
+ *    running status whenever the previous message had the same status;
+ *  - SysEx (F0) events as F0 followed by their data, escapes (F7) as their
+ *    raw data;
+ *  - no meta events. Set Tempo events change the timing only.
+ *
+ * In real time mode a message is delivered once the host clock reaches its
+ * time, divided by the tempo scale; in fast mode as soon as it is asked for.
+ * HardwareSerial then paces delivery at the baud rate unless it is unpaced.
+ */
+#ifndef HOST_SMF_H_
+#define HOST_SMF_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <vector>
+#include "HardwareSerial.h"
+
+class SmfTransport : public HostTransport {
+public:
+    ~SmfTransport();
+
+    // Open `path` if it is a type 0 or 1 MIDI file. Returns NULL if it
+    // isn't a MIDI file, or with `*pError` set if it is one that can't be
+    // played.
+    static SmfTransport *open(const char *path, const char **pError);
+
+    // Deliver messages as soon as they are asked for, ignoring their times.
+    void setFast(bool fast) { mFast = fast; }
+    // Play `scale` times faster than the file's tempo (real time mode).
+    void setTempoScale(double scale) { mScale = scale > 0 ? scale : 1.0; }
+
+    int receive(uint8_t *buf, int len);
+    void transmit(uint8_t b);
+    bool continuous() const { return mFast; }
+    void setOutput(int fd) { mOutFd = fd; }
+
+    // Time of the last message delivered, in file microseconds (before
+    // scaling), and the number of messages so far.
+    uint64_t position() const { return mLastTime; }
+    unsigned long messages() const { return mMessages; }
+
+private:
+    enum eventKind { kChannel, kSysEx, kEscape, kMeta, kEnd };
+
+    struct track {
+        long pos;               // File offset of the first byte not buffered.
+        long end;               // File offset just past the track.
+        uint8_t buf[64];
+        int bufPos;
+        int bufLen;
+
+        uint32_t tick;          // Time of the pending event.
+        uint8_t runningStatus;
+        // The pending event. Its header has been read, `remaining` bytes of
+        // data follow in the file.
+        eventKind kind;
+        uint8_t status;
+        uint8_t data[2];
+        uint8_t metaType;
+        uint32_t remaining;
+    };
+
+    SmfTransport(FILE *pFile, uint16_t division);
+
+    int nextByte(track &t);
+    bool readVarLen(track &t, uint32_t *pValue);
+    void readEvent(track &t);
+    void skip(track &t, uint32_t count);
+    uint64_t timeOf(uint32_t tick) const;
+    int startNext();
+
+    FILE *mFile;
+    int mOutFd;
+    std::vector<track> mTracks;
+
+    // Timing: microseconds at mBaseTick, and from there on mTempo
+    // microseconds per quarter note of mDivision ticks.
+    uint16_t mDivision;
+    uint32_t mTempo;
+    uint32_t mBaseTick;
+    uint64_t mBaseTime;
+    bool mSmpte;            // SMPTE time division: no tempo.
+
+    bool mFast;
+    double mScale;
+    bool mStarted;
+    unsigned long mStart;   // Host time the first message was due.
+
+    // The message being delivered: `mPrefix` generated bytes, then
+    // `mCopy` bytes read from track `mCurrent`.
+    uint8_t mPrefix[3];
+    int mPrefixLen;
+    int mPrefixPos;
+    uint32_t mCopy;
+    int mCurrent;
+    uint8_t mOutStatus;     // Running status of the delivered stream.
+
+    uint64_t mLastTime;
+    unsigned long mMessages;
+};
+
+#endif // HOST_SMF_H_
@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for <util/delay.h>.
+ *
+ * The busy waits take no time on the host, they only add their cycles to
+ * hostCycles().
+ */
+#ifndef HOST_UTIL_DELAY_H_
+#define HOST_UTIL_DELAY_H_
+
+#define F_CPU 16000000UL
+
+void _delay_us(double us);
+void _delay_ms(double ms);
+
+#endif // HOST_UTIL_DELAY_H_
@@ -0,0 +1,58 @@
+#include "wav.h"
+
+static void put16(FILE *f, uint16_t v) {
+    fputc(v & 0xFF, f);
+    fputc(v >> 8, f);
+}
+
+static void put32(FILE *f, uint32_t v) {
+    put16(f, v & 0xFFFF);
+    put16(f, v >> 16);
+}
+
+static void header(FILE *f, unsigned long sampleRate, unsigned long samples) {
+    uint32_t data = samples * 2;
+    fwrite("RIFF", 1, 4, f);
+    put32(f, 36 + data);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put32(f, 16);             // fmt chunk size
+    put16(f, 1);              // PCM
+    put16(f, 1);              // mono
+    put32(f, sampleRate);
+    put32(f, sampleRate * 2); // byte rate
+    put16(f, 2);              // block align
+    put16(f, 16);             // bits per sample
+    fwrite("data", 1, 4, f);
+    put32(f, data);
+}
+
+WavWriter::WavWriter() : mFile(NULL), mSampleRate(0), mSamples(0) {
+}
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+bool WavWriter::open(const char *path, unsigned long sampleRate) {
+    close();
+    mFile = fopen(path, "wb");
+    if (mFile == NULL) return false;
+    mSampleRate = sampleRate;
+    mSamples = 0;
+    header(mFile, mSampleRate, 0);
+    return true;
+}
+
+void WavWriter::write(int16_t sample) {
+    if (mFile == NULL) return;
+    put16(mFile, (uint16_t)sample);
+    mSamples++;
+}
+
+void WavWriter::close() {
+    if (mFile == NULL) return;
+    fseek(mFile, 0, SEEK_SET);
+    header(mFile, mSampleRate, mSamples);
+    fclose(mFile);
+    mFile = NULL;
+}
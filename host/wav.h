@@ -0,0 +1,29 @@
+/*
+ * Minimal writer for 16 bit mono PCM WAV files.
+ */
+#ifndef HOST_WAV_H_
+#define HOST_WAV_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+class WavWriter {
+public:
+    WavWriter();
+    ~WavWriter();
+
+    bool open(const char *path, unsigned long sampleRate);
+    void write(int16_t sample);
+    // Patch the header with the final length and close the file.
+    void close();
+
+    unsigned long sampleRate() const { return mSampleRate; }
+    unsigned long samples() const { return mSamples; }
+
+private:
+    FILE *mFile;
+    unsigned long mSampleRate;
+    unsigned long mSamples;
+};
+
+#endif // HOST_WAV_H_
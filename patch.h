@@ -5,67 +5,200 @@
  */
 
 #define PATCHNAME_LEN 8 // Max length of patch names.
+#define PATCH_PARAMS 27 // Parameter ids, 0 - 26.
 
-struct patchSettings {
+// Parameter ids, as loadParam() in the sketch numbers them.
+enum patchParam {
     // Oscillators
-    // A: 0-6
-    int waveOscA;    // 0 - 6
-    int pulseWidthOscA; // 12-bit
-    int attackOscA;  // nibble
-    int decayOscA;   // nibble
-    int sustainOscA; // nibble
-    int releaseOscA; // nibble
-    int filterOscA; // bool
-
-    // B: 7-14
-    int waveOscB;
-    int pulseWidthOscB;
-    int attackOscB;
-    int decayOscB;
-    int sustainOscB;
-    int releaseOscB;
-    int filterOscB;
-    int detuneOscB;
-
-    // C: 15-22
-    int waveOscC;
-    int pulseWidthOscC;
-    int attackOscC;
-    int decayOscC;
-    int sustainOscC;
-    int releaseOscC;
-    int filterOscC;
-    int detuneOscC;
-
-    // Filter: 23-25
-    int cutoff;     // 11-bit
-    int resonance;  // nibble
-    int mode;       // 0 - 4
-
-    // General: 26
-    int volume;     // nibble
+    PATCH_WAVE_A, PATCH_PULSE_WIDTH_A, PATCH_ATTACK_A, PATCH_DECAY_A,
+    PATCH_SUSTAIN_A, PATCH_RELEASE_A, PATCH_FILTER_A,
+    PATCH_WAVE_B, PATCH_PULSE_WIDTH_B, PATCH_ATTACK_B, PATCH_DECAY_B,
+    PATCH_SUSTAIN_B, PATCH_RELEASE_B, PATCH_FILTER_B, PATCH_DETUNE_B,
+    PATCH_WAVE_C, PATCH_PULSE_WIDTH_C, PATCH_ATTACK_C, PATCH_DECAY_C,
+    PATCH_SUSTAIN_C, PATCH_RELEASE_C, PATCH_FILTER_C, PATCH_DETUNE_C,
+
+    // Filter
+    PATCH_CUTOFF, PATCH_RESONANCE, PATCH_MODE,
+
+    // General
+    PATCH_VOLUME,
     // portamento
     // retrigger
+};
+
+// The parameter values, each in as many bits as its range needs (a 3 bit
+// waveform, 12 bit pulse widths, nibbles, a 1 bit filter enable), 133 bits in
+// all. Read and write them with getPatchValue() and putPatchValue().
+#define PATCH_VALUES_LEN 17
+
+// Where each parameter's bits are: first bit, bits. The descriptor table in
+// patch.cpp and PATCH_VALUES both take them from here.
+#define PATCH_BITS_WAVE_A            0,  3
+#define PATCH_BITS_PULSE_WIDTH_A     3, 12
+#define PATCH_BITS_ATTACK_A         15,  4
+#define PATCH_BITS_DECAY_A          19,  4
+#define PATCH_BITS_SUSTAIN_A        23,  4
+#define PATCH_BITS_RELEASE_A        27,  4
+#define PATCH_BITS_FILTER_A         31,  1
+
+#define PATCH_BITS_WAVE_B           32,  3
+#define PATCH_BITS_PULSE_WIDTH_B    35, 12
+#define PATCH_BITS_ATTACK_B         47,  4
+#define PATCH_BITS_DECAY_B          51,  4
+#define PATCH_BITS_SUSTAIN_B        55,  4
+#define PATCH_BITS_RELEASE_B        59,  4
+#define PATCH_BITS_FILTER_B         63,  1
+#define PATCH_BITS_DETUNE_B         64,  8
+
+#define PATCH_BITS_WAVE_C           72,  3
+#define PATCH_BITS_PULSE_WIDTH_C    75, 12
+#define PATCH_BITS_ATTACK_C         87,  4
+#define PATCH_BITS_DECAY_C          91,  4
+#define PATCH_BITS_SUSTAIN_C        95,  4
+#define PATCH_BITS_RELEASE_C        99,  4
+#define PATCH_BITS_FILTER_C        103,  1
+#define PATCH_BITS_DETUNE_C        104,  8
+
+#define PATCH_BITS_CUTOFF          112, 11
+#define PATCH_BITS_RESONANCE       123,  4
+#define PATCH_BITS_MODE            127,  2
+
+#define PATCH_BITS_VOLUME          129,  4
+
+// The same packing at compile time, for patches kept in flash: an initializer
+// for patchSettings.values from the 27 values in parameter id order, each
+// truncated to its bits. Byte k of it is every parameter's bits in byte k,
+// none for a parameter with no bits there.
+#define PATCH_BYTE(v, bits, k) PATCH_BYTE_(v, bits, k)
+#define PATCH_BYTE_(v, pos, width, k) \
+    ((k) < ((pos) >> 3) || (k) > (((pos) + (width) - 1) >> 3) ? 0 : \
+        (uint8_t)((((unsigned long)(v) & ((1UL << (width)) - 1)) << ((pos) & 7)) \
+            >> 8 * (((k) - ((pos) >> 3)) & 3)))
+#define PATCH_PACK(k, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, \
+        v14, v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26) (uint8_t)( \
+    PATCH_BYTE(v0, PATCH_BITS_WAVE_A, k) \
+    | PATCH_BYTE(v1, PATCH_BITS_PULSE_WIDTH_A, k) \
+    | PATCH_BYTE(v2, PATCH_BITS_ATTACK_A, k) \
+    | PATCH_BYTE(v3, PATCH_BITS_DECAY_A, k) \
+    | PATCH_BYTE(v4, PATCH_BITS_SUSTAIN_A, k) \
+    | PATCH_BYTE(v5, PATCH_BITS_RELEASE_A, k) \
+    | PATCH_BYTE(v6, PATCH_BITS_FILTER_A, k) \
+    | PATCH_BYTE(v7, PATCH_BITS_WAVE_B, k) \
+    | PATCH_BYTE(v8, PATCH_BITS_PULSE_WIDTH_B, k) \
+    | PATCH_BYTE(v9, PATCH_BITS_ATTACK_B, k) \
+    | PATCH_BYTE(v10, PATCH_BITS_DECAY_B, k) \
+    | PATCH_BYTE(v11, PATCH_BITS_SUSTAIN_B, k) \
+    | PATCH_BYTE(v12, PATCH_BITS_RELEASE_B, k) \
+    | PATCH_BYTE(v13, PATCH_BITS_FILTER_B, k) \
+    | PATCH_BYTE(v14, PATCH_BITS_DETUNE_B, k) \
+    | PATCH_BYTE(v15, PATCH_BITS_WAVE_C, k) \
+    | PATCH_BYTE(v16, PATCH_BITS_PULSE_WIDTH_C, k) \
+    | PATCH_BYTE(v17, PATCH_BITS_ATTACK_C, k) \
+    | PATCH_BYTE(v18, PATCH_BITS_DECAY_C, k) \
+    | PATCH_BYTE(v19, PATCH_BITS_SUSTAIN_C, k) \
+    | PATCH_BYTE(v20, PATCH_BITS_RELEASE_C, k) \
+    | PATCH_BYTE(v21, PATCH_BITS_FILTER_C, k) \
+    | PATCH_BYTE(v22, PATCH_BITS_DETUNE_C, k) \
+    | PATCH_BYTE(v23, PATCH_BITS_CUTOFF, k) \
+    | PATCH_BYTE(v24, PATCH_BITS_RESONANCE, k) \
+    | PATCH_BYTE(v25, PATCH_BITS_MODE, k) \
+    | PATCH_BYTE(v26, PATCH_BITS_VOLUME, k))
+#define PATCH_VALUES(v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, \
+        v14, v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26) { \
+    PATCH_PACK(0, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(1, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(2, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(3, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(4, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(5, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(6, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(7, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(8, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(9, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(10, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(11, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(12, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(13, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(14, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(15, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26), \
+    PATCH_PACK(16, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, \
+        v15, v16, v17, v18, v19, v20, v21, v22, v23, v24, v25, v26) }
+
+struct patchSettings {
+    uint8_t values[PATCH_VALUES_LEN];
 
     // System
-    int id;
-    char name[8];
+    uint8_t id;
+    char name[PATCHNAME_LEN];
 };
 
-struct livePatch {
+// SID chips on the bus, 1-4. How each is selected is up to sidbus.h.
+#ifndef SID_CHIPS
+#define SID_CHIPS 1
+#endif
+
+// What one chip is given: the patch's registers, with its own pitch, gates
+// and velocity.
+struct sidChip {
     uint8_t registers[25];
+    uint8_t note;
+
+    // Register transaction, see beginSR() and commitSR() in the sketch.
+    uint32_t staged;    // Registers changed since the last commit.
+    uint8_t gateClosed; // Voices whose gate was closed since the last commit.
+};
+
+struct livePatch {
+    uint8_t registers[25]; // The patch, as every chip gets it.
     patchSettings patch;
-    int note;
+    sidChip chips[SID_CHIPS];
+    uint8_t depth;      // beginSR()s not yet committed.
 };
 
 // Returns two bytes, one register value in each.
 uint16_t patchParamRegister(int param);
 
+// Register masks, bit n for register n. A parameter's is the registers its
+// value feeds in livePatch.registers; none for detune and volume, which the
+// sketch applies itself.
+uint32_t patchParamRegisters(int param);
+
+// The registers fed by parameters that differ between two patches.
+uint32_t patchChangedRegisters(const patchSettings *a, const patchSettings *b);
+
+// Recompute the registers in `regs` from the patch's values, each from every
+// parameter that feeds it and stored once, so the result is what a rebuild
+// of all of them would give.
+void patchUpdateRegisters(livePatch *p, uint32_t regs);
 void patchToRegisters(livePatch *p);
 
+// A parameter of a packed patch. Values are truncated to their bits.
+int getPatchValue(const patchSettings *s, int param);
+void putPatchValue(patchSettings *s, int param, int val);
+
 int loadPatchValue(int param, livePatch *p);
 
 // Update the setting, and the register value.
 void setPatchValue(livePatch *p, int param, int val);
 
+// Only the registers the new values change are recomputed, so pDest's
+// registers have to match its values already: build them in full with
+// patchToRegisters() first. A zeroed livePatch doesn't match, as wave and
+// mode 0 don't encode to 0.
 bool copyPatch(patchSettings *pSrc, livePatch *pDest);
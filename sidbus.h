@@ -0,0 +1,193 @@
+/*
+ * The bus from the AVR to the SID: two cascaded 74HC595 shift registers
+ * holding the register address and value, and the SID's chip select.
+ *
+ * A write shifts sixteen bits, least significant first, address byte then
+ * value byte, latches them onto the SID's address and data lines and pulses
+ * chip select low. Each backend does that its own way:
+ *
+ *  - sidBusShiftOut: shiftOut() and digitalWrite(), as the sketch always
+ *    has. Works on any pins; around 3000 cycles (190us) a register.
+ *  - sidBusPort: sbi/cbi straight to PORTC. Same wiring, DS, ST_CP, SH_CP
+ *    and CS on A0-A3 (PC0-PC3); around 140 cycles a register.
+ *  - sidBusSpi: the SPI peripheral shifts both bytes at 8MHz, latch and
+ *    chip select stay on PORTC; around 80 cycles a register. Needs DS moved
+ *    to D11 (MOSI) and SH_CP to D13 (SCK). D10 is SS, which has to stay an
+ *    output or high while the SPI is master, so the sketch moves the esc
+ *    button to D12 (MISO, an input while the SPI is master).
+ *
+ * Pick one by defining SID_BUS before this header is included. Each is a
+ * struct of static functions, so a backend can also be named directly (see
+ * host/busbench.cpp).
+ *
+ * With more than one chip (SID_CHIPS, patch.h) SID_SELECT says how a write
+ * reaches the right one:
+ *
+ *  - SID_SELECT_ADDRESS: the chip number rides in bits 5 and 6 of the
+ *    address byte, where a 74HC139 decodes it, enabled by CS (A3), into a
+ *    chip select per chip. No extra pins, any backend.
+ *  - SID_SELECT_PINS: each chip has its own CS, on A3, D11, D12 and D13 in
+ *    turn. Not with the SPI backend, which needs D11 and D13.
+ */
+#ifndef SIDBUS_H_
+#define SIDBUS_H_
+
+#include <Arduino.h>
+#include <avr/io.h>
+#include <util/delay.h>
+
+#define SID_BUS_SHIFTOUT 0
+#define SID_BUS_PORT     1
+#define SID_BUS_SPI      2
+
+#ifndef SID_BUS
+#define SID_BUS SID_BUS_PORT
+#endif
+
+#define SID_SELECT_ADDRESS 0
+#define SID_SELECT_PINS    1
+
+#ifndef SID_SELECT
+#define SID_SELECT SID_SELECT_ADDRESS
+#endif
+
+#if SID_SELECT == SID_SELECT_PINS && SID_BUS == SID_BUS_SPI
+#error "SID_SELECT_PINS needs D11 and D13, which the SPI bus uses"
+#endif
+
+// Chip select is held low this long, so that at least one falling edge of
+// the 1MHz SID clock, which is when the chip takes the write, lands inside.
+#define SID_CS_HOLD_US 2
+
+const uint8_t sr_ds = A0;
+const uint8_t sr_st_cp = A1;
+const uint8_t sr_sh_cp = A2;
+const uint8_t sid_cs = A3;
+const uint8_t sid_cs_pins[4] = {A3, 11, 12, 13};  // SID_SELECT_PINS
+
+// SPI wiring.
+const uint8_t spi_ss = 10;
+const uint8_t spi_mosi = 11;
+const uint8_t spi_sck = 13;
+
+// Chip selection common to the backends.
+struct sidSelect {
+    static void begin() {
+        uint8_t pins = SID_SELECT == SID_SELECT_PINS ? 4 : 1;
+        for (uint8_t i = 0; i < pins; i++) {
+            pinMode(sid_cs_pins[i], OUTPUT);
+            digitalWrite(sid_cs_pins[i], HIGH);
+        }
+    }
+
+    // The address byte for register `reg` of chip `chip`.
+    static inline uint8_t address(uint8_t chip, uint8_t reg) {
+        return SID_SELECT == SID_SELECT_ADDRESS ? reg | chip << 5 : reg;
+    }
+
+    static inline uint8_t pin(uint8_t chip) {
+        return SID_SELECT == SID_SELECT_PINS ? sid_cs_pins[chip & 3] : sid_cs;
+    }
+
+    // Chip select by port, sbi and cbi: A3 is PC3, D11-D13 are PB3-PB5.
+    static inline void low(uint8_t chip) {
+        if (SID_SELECT == SID_SELECT_ADDRESS || chip == 0) PORTC &= ~_BV(PORTC3);
+        else PORTB &= ~_BV(PORTB3 + chip - 1);
+    }
+
+    static inline void high(uint8_t chip) {
+        if (SID_SELECT == SID_SELECT_ADDRESS || chip == 0) PORTC |= _BV(PORTC3);
+        else PORTB |= _BV(PORTB3 + chip - 1);
+    }
+};
+
+struct sidBusShiftOut {
+    static void begin() {
+        pinMode(sr_ds, OUTPUT);
+        pinMode(sr_sh_cp, OUTPUT);
+        pinMode(sr_st_cp, OUTPUT);
+        sidSelect::begin();
+    }
+
+    static void write(uint8_t chip, uint8_t reg, uint8_t val) {
+        digitalWrite(sr_st_cp, LOW);
+        shiftOut(sr_ds, sr_sh_cp, LSBFIRST, sidSelect::address(chip, reg));
+        shiftOut(sr_ds, sr_sh_cp, LSBFIRST, val);
+        digitalWrite(sr_st_cp, HIGH);
+
+        // Data is written as clock goes from high to low. The digitalWrite()
+        // calls alone keep chip select low for around three SID clock cycles.
+        uint8_t cs = sidSelect::pin(chip);
+        digitalWrite(cs, LOW);
+        digitalWrite(cs, HIGH);
+    }
+};
+
+struct sidBusPort {
+    static void begin() {
+        sidBusShiftOut::begin();
+    }
+
+    static inline void shift(uint8_t b) {
+        for (uint8_t i = 0; i < 8; i++, b >>= 1) {
+            if (b & 1) PORTC |= _BV(PORTC0);
+            else PORTC &= ~_BV(PORTC0);
+            PORTC |= _BV(PORTC2);
+            PORTC &= ~_BV(PORTC2);
+        }
+    }
+
+    static inline void write(uint8_t chip, uint8_t reg, uint8_t val) {
+        PORTC &= ~_BV(PORTC1);
+        shift(sidSelect::address(chip, reg));
+        shift(val);
+        PORTC |= _BV(PORTC1);
+
+        sidSelect::low(chip);
+        _delay_us(SID_CS_HOLD_US);
+        sidSelect::high(chip);
+    }
+};
+
+struct sidBusSpi {
+    static void begin() {
+        pinMode(spi_ss, OUTPUT);
+        pinMode(spi_mosi, OUTPUT);
+        pinMode(spi_sck, OUTPUT);
+        pinMode(sr_st_cp, OUTPUT);
+        sidSelect::begin();
+
+        // Master, mode 0 (the 595 shifts on the rising edge), LSB first, at
+        // half the CPU clock.
+        SPCR = _BV(SPE) | _BV(MSTR) | _BV(DORD);
+        SPSR = _BV(SPI2X);
+    }
+
+    static inline void shift(uint8_t b) {
+        SPDR = b;
+        while (!(SPSR & _BV(SPIF)));
+    }
+
+    static inline void write(uint8_t chip, uint8_t reg, uint8_t val) {
+        PORTC &= ~_BV(PORTC1);
+        shift(sidSelect::address(chip, reg));
+        shift(val);
+        PORTC |= _BV(PORTC1);
+
+        sidSelect::low(chip);
+        _delay_us(SID_CS_HOLD_US);
+        sidSelect::high(chip);
+    }
+};
+
+#if SID_BUS == SID_BUS_SHIFTOUT
+typedef sidBusShiftOut sidBus;
+#elif SID_BUS == SID_BUS_PORT
+typedef sidBusPort sidBus;
+#elif SID_BUS == SID_BUS_SPI
+typedef sidBusSpi sidBus;
+#else
+#error "SID_BUS must be SID_BUS_SHIFTOUT, SID_BUS_PORT or SID_BUS_SPI"
+#endif
+
+#endif // SIDBUS_H_
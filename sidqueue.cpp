@@ -0,0 +1,58 @@
+#include <Arduino.h>
+#include "sidqueue.h"
+
+// Keep the compiler from moving the slot copy past the index update.
+#define barrier() __asm__ __volatile__("" ::: "memory")
+
+uint16_t sidQueueNow(const sidQueue *q) {
+    // Sixteen bits take two reads on the AVR, so the tick can't change
+    // in between.
+    noInterrupts();
+    uint16_t now = q->now;
+    interrupts();
+    return now;
+}
+
+void pushSidWrite(sidQueue *q, uint8_t reg, uint8_t val, uint16_t due) {
+    pushSidWrites(q, &reg, &val, 1, due);
+}
+
+void pushSidWrites(sidQueue *q, const uint8_t *regs, const uint8_t *vals, uint8_t n, uint16_t due) {
+    if (n == 0) return;
+    uint8_t head = q->head;
+    // Full: wait for the interrupt to make room. Reading the tick lets it in
+    // on the host too, which only runs its timer when interrupts are touched.
+    while ((uint8_t)(head - q->tail) > SID_QUEUE_LEN - n) sidQueueNow(q);
+
+    if ((int16_t)(due - q->lastDue) < 0 && head != q->tail) due = q->lastDue;
+    for (uint8_t i = 0; i < n; i++) {
+        queuedWrite *w = &q->writes[(uint8_t)(head + i) & (SID_QUEUE_LEN - 1)];
+        w->reg = regs[i] | (i + 1 < n ? SID_WRITE_MORE : 0);
+        w->val = vals[i];
+        w->due = due;
+    }
+    q->lastDue = due;
+    barrier();
+    q->head = head + n;
+
+    uint8_t count = (uint8_t)(head + n - q->tail);
+    if (count > q->highWater) q->highWater = count;
+}
+
+uint16_t sidQueueTick(sidQueue *q) {
+    uint16_t now = q->now + 1;
+    q->now = now;
+    return now;
+}
+
+bool popSidWrite(sidQueue *q, uint16_t now, queuedWrite *pWrite) {
+    uint8_t tail = q->tail;
+    if (tail == q->head) return false;
+    const queuedWrite *w = &q->writes[tail & (SID_QUEUE_LEN - 1)];
+    if ((int16_t)(now - w->due) < 0) return false;
+    if (now != w->due) q->late++;
+    *pWrite = *w;
+    barrier();
+    q->tail = tail + 1;
+    return true;
+}
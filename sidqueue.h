@@ -0,0 +1,59 @@
+/*
+ * A queue of SID register writes, from loop() to a timer interrupt.
+ *
+ * loop() decides what the chip should hold and when; the timer interrupt
+ * writes it. Every entry carries the tick it is due on, and the interrupt
+ * only writes entries whose tick has come, so changes land on a fixed grid
+ * of SID_TICK_US however long the pass that made them took. Single
+ * producer, single consumer, as the event queue (event.h).
+ */
+#ifndef SIDQUEUE_H_
+#define SIDQUEUE_H_
+
+#include <inttypes.h>
+
+#define SID_QUEUE_LEN 64        // Must be a power of two, at most 128.
+#define SID_TICK_US 500         // Grid spacing. setup() programs Timer2 for it.
+#define SID_WRITE_LATENCY 4     // Ticks from a MIDI event to its writes.
+#define SID_WRITES_PER_TICK 32  // Most writes the interrupt makes per tick.
+
+#define SID_WRITE_MORE 0x80     // In queuedWrite.reg: more of the same batch follow.
+#define SID_WRITE_CHIP 0x60     // In queuedWrite.reg: the chip, shifted by 5.
+
+struct queuedWrite {
+    uint8_t reg;                // Register, chip and SID_WRITE_MORE.
+    uint8_t val;
+    uint16_t due;               // Tick to write on.
+};
+
+struct sidQueue {
+    queuedWrite writes[SID_QUEUE_LEN];
+    volatile uint8_t head;      // Next slot to fill, written by loop().
+    volatile uint8_t tail;      // Next slot to write, written by the interrupt.
+    volatile uint16_t now;      // Ticks so far, written by the interrupt.
+    uint16_t lastDue;           // Due tick of the newest entry.
+    volatile uint16_t late;     // Entries written after their tick.
+    uint8_t highWater;          // Deepest the queue has been.
+};
+
+// Producer side. Entries are written in order, so one due before the newest
+// entry is moved to its tick. Waits for the interrupt to make room if the
+// queue is full.
+void pushSidWrite(sidQueue *q, uint8_t reg, uint8_t val, uint16_t due);
+
+// Producer side: `n` writes as one batch. The interrupt sees none of them
+// until all are queued, and takes them on the same tick. At most
+// SID_QUEUE_LEN - 1.
+void pushSidWrites(sidQueue *q, const uint8_t *regs, const uint8_t *vals, uint8_t n, uint16_t due);
+
+// Producer side: the current tick.
+uint16_t sidQueueNow(const sidQueue *q);
+
+// Consumer side, from the interrupt. Advances the tick.
+uint16_t sidQueueTick(sidQueue *q);
+
+// Consumer side. Returns false if the queue is empty or the oldest entry is
+// not yet due on tick `now`.
+bool popSidWrite(sidQueue *q, uint16_t now, queuedWrite *pWrite);
+
+#endif // SIDQUEUE_H_
@@ -28,6 +28,7 @@ Rotary Encoder
 Esc button
 
  * momentary switch to digital pin 10
+ * (digital pin 12 with the SPI bus, which needs pin 10, see sidbus.h)
 
 MIDI
 
@@ -38,6 +39,7 @@ Shift register A
  * DS to analogue pin 0
  * ST_CP to analogue pin 1
  * SH_CP to analogue pin 2
+ * (the SPI bus moves DS to digital pin 11 and SH_CP to 13, see sidbus.h)
 
 Shift register B
 
@@ -49,6 +51,7 @@ SID
 
  * CLK from digital pin 9
  * CS from analogue pin 3
+ * (more than one chip: CS through a 74HC139, or one CS pin each, see sidbus.h)
  
 */
 
@@ -56,23 +59,43 @@ SID
 #include <math.h>
 #include "utils.h"
 #include "patch.h"
+#include "bank.h"
+#include "userbank.h"
 #include "param.h"
+#include "event.h"
 #include "MIDI.h"
+#include "sidbus.h"
+#include "sidqueue.h"
+#include "sidtrace.h"
 
-#define PROGRAMS_AVAILABLE 19 
+#define PROGRAMS_AVAILABLE (PATCH_BANK_LEN - 1)
 #define NO_PARAM 0xFF
 
+// 1 sends a trace of every SID register write (see sidtrace.h) out of the
+// serial port, in place of MIDI Thru and the status dump.
+#ifndef SID_TRACE
+#define SID_TRACE 0
+#endif
+
+// How notes are spread over the chips (SID_CHIPS, patch.h). Each chip plays
+// one note with all three of its voices, as the patch asks.
+//  - SID_VOICES_POLY: a note each, so as many at once as there are chips. A
+//    new note takes the chip that has been free longest, or steals the one
+//    that started first.
+//  - SID_VOICES_LAYER: every chip plays every note, e.g. one per channel
+//    for stereo.
+#define SID_VOICES_POLY  0
+#define SID_VOICES_LAYER 1
+
+#ifndef SID_VOICES
+#define SID_VOICES SID_VOICES_POLY
+#endif
+
 LiquidCrystal lcd(A5, A4, 7, 6, 5, 4);
 const int enc_a = 2;
 const int enc_b = 3;
 const int enc_button = 8;
-const int button_esc = 10;
-
-const int sr_ds = A0;
-const int sr_st_cp= A1;
-const int sr_sh_cp= A2;
-
-const int sid_cs = A3;
+const int button_esc = SID_BUS == SID_BUS_SPI ? 12 : 10;  // D10 is the SPI's SS.
 
 // Clock settings are duplicated in setup()
 const int sid_clk_reg = PORTB;
@@ -87,13 +110,74 @@ const int param_confirm = -1;
 const int lcd_width = 16;
 const int lcd_lines = 2;
 
+// SysEx, under the non-commercial manufacturer id.
+// F0 7D 01 F7 asks for a status dump, answered by F0 7D 02 <counters> F7.
+const byte sysex_id = 0x7D;
+const byte sysex_status_request = 0x01;
+const byte sysex_status_reply = 0x02;
+
 // Global state.
 signed int encoderVal;
-uint8_t midiOn[3];
-uint8_t midiCC[3];
-bool midiNotePlayed = false;
-bool midiControlPlayed = false;
+eventQueue midiEvents;  // Filled by the MIDI callbacks, drained each loop().
+uint8_t lastCC = 0;     // Controller number of the last CC played.
 uint8_t midiAssignments[120];
+patchNamePage patchNames;   // The patch browser's page of names.
+userBank userPatches;       // Saved patches, written to EEPROM in idle time.
+
+// What each SID holds once the write queue has drained. Their registers are
+// write only, so this is the only record of them; registers not written since
+// power up are in sidUnknown.
+sidQueue sidWriteQueue;     // Drained by the Timer2 interrupt.
+uint8_t sidShadow[SID_CHIPS][25];
+uint32_t sidUnknown[SID_CHIPS];
+
+// Optional tap on every register write, e.g. a trace recorder.
+void (*sidWriteTap)(unsigned long time, uint8_t chip, uint8_t reg, uint8_t val) = NULL;
+#if SID_TRACE
+sidTrace serialTrace;
+#endif
+
+// Prototypes. The Arduino IDE generates these, other compilers need them.
+void queueMidiEvent(byte type, byte channel, byte data1, byte data2);
+void HandleNoteOn(byte channel, byte note, byte velocity);
+void HandleNoteOff(byte channel, byte note, byte velocity);
+void HandleControlChange(byte channel, byte number, byte value);
+void HandleProgramChange(byte channel, byte number);
+void HandleSystemExclusive(byte *array, unsigned int size);
+byte packSysEx(byte *pMsg, byte len, unsigned long val, byte groups);
+void sendStatusDump();
+void readEncoder();
+int pollButtons();
+bool updateState(int *pPage, livePatch *pPatch, param *pParam, int *pValue, int update, uint8_t playedParam);
+void updateMenu(int *pPage, livePatch *pPatch, param *pParam, int *pValue);
+boolean loadParamOption(param *pParam, int idx, char *pStr);
+boolean loadParam(int id, param *pParam);
+bool loadPatch(int id, livePatch *pProg);
+bool loadPatchSettings(int id, patchSettings *pDest);
+void writeSidRegister(byte chip, byte loc, byte val);
+void serialTracePut(uint8_t b);
+void serialTraceTap(unsigned long time, uint8_t chip, uint8_t reg, uint8_t val);
+void beginSR(livePatch *p);
+void writeSR(livePatch *p, uint8_t i);
+void writeChipSR(livePatch *p, uint8_t c, uint8_t i);
+void commitSR(livePatch *p, uint16_t due);
+uint16_t sidDue(unsigned long time);
+void updateSynth(livePatch *p);
+bool changeProgram(livePatch *p, int program, uint16_t due);
+void noteToRegisters(livePatch *p, uint8_t c, char osc);
+uint8_t updatePerformance(livePatch *p);
+void updatePerfParam(livePatch *pPatch, int param, int val);
+
+// MIDI input. Messages are dispatched to these at compile time, everything
+// else is ignored.
+struct synthMidiHandler : MIDI_NullHandler {
+    static inline void noteOn(byte channel, byte note, byte velocity) { HandleNoteOn(channel, note, velocity); }
+    static inline void noteOff(byte channel, byte note, byte velocity) { HandleNoteOff(channel, note, velocity); }
+    static inline void controlChange(byte channel, byte number, byte value) { HandleControlChange(channel, number, value); }
+    static inline void programChange(byte channel, byte number) { HandleProgramChange(channel, number); }
+    static inline void systemExclusive(byte *array, unsigned int size) { HandleSystemExclusive(array, size); }
+};
+MIDI_Static<synthMidiHandler, HardwareSerial> MIDI(Serial);
 
 void setup() {
 
@@ -103,6 +187,12 @@ void setup() {
     OCR1A = 7;                         //top value for counter
     TCCR1B = _BV(WGM12) | _BV(CS10);   //CTC mode, prescaler clock/1
 
+    //Use Timer/Counter2 to interrupt every SID_TICK_US, for the SID writes.
+    TCCR2A = _BV(WGM21);               //CTC mode
+    TCCR2B = _BV(CS22);                //prescaler clock/64, 4us a count
+    OCR2A = SID_TICK_US / 4 - 1;       //top value for counter
+    TIMSK2 = _BV(OCIE2A);              //interrupt on compare match
+
     pinMode(enc_button, INPUT);
     
     pinMode(enc_a, INPUT);
@@ -113,18 +203,20 @@ void setup() {
     pinMode(button_esc, INPUT);
     digitalWrite(button_esc, HIGH);
 
-    pinMode(sr_ds, OUTPUT);
-    pinMode(sr_sh_cp, OUTPUT);
-    pinMode(sr_st_cp, OUTPUT);
-
-    pinMode(sid_cs, OUTPUT);
-    digitalWrite(sid_cs, HIGH);
+    sidBus::begin();
+    for (int c = 0; c < SID_CHIPS; c++) sidUnknown[c] = 0x1FFFFFFUL;
 
-    for (int i; i < 120; i++) midiAssignments[i] = 0xFF;
+    for (int i = 0; i < 120; i++) midiAssignments[i] = 0xFF;
+    beginUserBank(&userPatches);
     MIDI.begin();
-    MIDI.setHandleNoteOn(HandleNoteOn);
-    MIDI.setHandleNoteOff(HandleNoteOff);
-    MIDI.setHandleControlChange(HandleControlChange);
+    // Pass everything on to the next synth in the chain as it arrives.
+    MIDI.turnThruOn(Full);
+    MIDI.setThruCutThrough(true);
+#if SID_TRACE
+    MIDI.turnThruOff();
+    beginSidTrace(&serialTrace, serialTracePut, 1000000UL);
+    sidWriteTap = serialTraceTap;
+#endif
     
     delay(500);
     lcd.begin(lcd_width, lcd_lines);
@@ -151,14 +243,37 @@ void loop() {
 
     if (page == menu_start) {
         page = menu_patch;
-        loadPatch(0, &patch);
+        // The registers are built in full once, loadPatch() keeps them up.
+        loadPatchSettings(0, &patch.patch);
+        patchToRegisters(&patch);
         updateSynth(&patch);
     }
 
-    MIDI.read();
+    // Take everything that has arrived (within a budget) before the UI gets
+    // a look in, so the serial buffer can't fill up behind slow passes. A
+    // byte can complete a message (a program change under running status is
+    // one byte), so take no more than the event queue has room for: the rest
+    // waits in the serial buffer for the next pass.
+    for (unsigned int budget = MIDI_DefaultSettings::BatchSize; budget > 0 && Serial.available(); ) {
+        unsigned int room = EVENT_QUEUE_LEN - eventCount(&midiEvents);
+        if (room == 0) break;
+        if (room > budget) room = budget;
+        MIDI.readBatch(room);
+        budget -= room;
+    }
 
+    uint8_t program = patch.patch.id;
     needsUpdate = updateState(&page, &patch, &parameter, &value, pollButtons(),
                                 updatePerformance(&patch)) || needsUpdate;
+    // A program change over MIDI shows in the patch name.
+    needsUpdate = needsUpdate || patch.patch.id != program;
+
+    // Everything else this pass changed (the menu) goes out on the next
+    // tick the latency allows.
+    commitSR(&patch, sidDue(micros()));
+
+    // Saves go to the EEPROM a byte at a time, when no MIDI is waiting.
+    if (!Serial.available()) userBankIdle(&userPatches);
 
     // Limit frequency of UI updates.
     if (needsUpdate && lastUpdate < (millis() + 500)) {
@@ -169,25 +284,65 @@ void loop() {
 }
 
 // MIDI Callbacks
+void queueMidiEvent(byte type, byte channel, byte data1, byte data2) {
+    midiEvent e = {type, channel, data1, data2, micros()};
+    pushEvent(&midiEvents, &e);
+}
+
 void HandleNoteOn(byte channel, byte note, byte velocity) {
-    midiNotePlayed = true;
-    midiOn[0] = channel;
-    midiOn[1] = note;
-    midiOn[2] = velocity;
+    queueMidiEvent(NoteOn, channel, note, velocity);
 }
 
 void HandleNoteOff(byte channel, byte note, byte velocity) {
-    midiNotePlayed = true;
-    midiOn[0] = channel;
-    midiOn[1] = note;
-    midiOn[2] = 0;
+    queueMidiEvent(NoteOff, channel, note, 0);
 }
 
 void HandleControlChange(byte channel, byte number, byte value) {
-    midiControlPlayed = true;
-    midiCC[0] = channel;
-    midiCC[1] = number;
-    midiCC[2] = value;
+    queueMidiEvent(ControlChange, channel, number, value);
+}
+
+void HandleProgramChange(byte channel, byte number) {
+    queueMidiEvent(ProgramChange, channel, number, 0);
+}
+
+void HandleSystemExclusive(byte *array, unsigned int size) {
+    // The array includes the F0 and F7 framing.
+    if (size == 4 && array[1] == sysex_id && array[2] == sysex_status_request) {
+        sendStatusDump();
+    }
+}
+
+// Append `val` to a SysEx payload as `groups` 7-bit groups, least significant
+// first. Returns the new length.
+byte packSysEx(byte *pMsg, byte len, unsigned long val, byte groups) {
+    for (byte i = 0; i < groups; i++) {
+        pMsg[len++] = val & 0x7F;
+        val >>= 7;
+    }
+    return len;
+}
+
+// Report what was lost and where: input counters from the MIDI library
+// (serial buffer overflows), then the event queue between the callbacks and
+// the engine, then the SID writes that missed their tick.
+void sendStatusDump() {
+#if SID_TRACE
+    return; // The serial port is carrying the trace.
+#endif
+    const midistats &stats = MIDI.getInputStats();
+    byte msg[25];
+    byte len = 0;
+    msg[len++] = sysex_id;
+    msg[len++] = sysex_status_reply;
+    len = packSysEx(msg, len, stats.bytesDiscarded, 5);
+    len = packSysEx(msg, len, stats.messagesLost, 3);
+    len = packSysEx(msg, len, stats.overflows, 3);
+    len = packSysEx(msg, len, stats.rxHighWater, 2);
+    len = packSysEx(msg, len, midiEvents.dropped, 3);
+    len = packSysEx(msg, len, midiEvents.highWater, 2);
+    len = packSysEx(msg, len, sidWriteQueue.late, 3);
+    len = packSysEx(msg, len, sidWriteQueue.highWater, 2);
+    MIDI.sendSysEx(len, msg);
 }
 
 // Interrupt handler for the rotary encoder.
@@ -239,8 +394,7 @@ bool updateState(int *pPage, livePatch *pPatch, param *pParam, int *pValue, int
         if (encoderVal < 0) { encoderVal = 0; return true; }
         if (encoderVal > PROGRAMS_AVAILABLE) { encoderVal = PROGRAMS_AVAILABLE; return true; }
         if (update & 1) {
-            loadPatch(encoderVal, pPatch);
-            updateSynth(pPatch);
+            changeProgram(pPatch, encoderVal, sidDue(micros()));
             loadParam(0, pParam);
             *pValue = loadPatchValue(pParam->id, pPatch);
             *pPage = menu_param;
@@ -283,6 +437,15 @@ bool updateState(int *pPage, livePatch *pPatch, param *pParam, int *pValue, int
 
         // Respond to inputs.
         if (update & 1) {
+            if (pParam->id == param_confirm && *pValue == 1) {
+                // Over the program it was loaded as. The menu shows how it
+                // went until the encoder moves.
+                *pValue = saveUserPatch(&userPatches, &pPatch->patch) ? 2 : 3;
+                forgetPatchNames(&patchNames);
+                *pPage = menu_param;
+                encoderVal = curEncoderVal = pParam->id;
+                return true;
+            }
             // Backout to parameter selection
             *pPage = menu_param;
             encoderVal = pParam->id;
@@ -290,11 +453,11 @@ bool updateState(int *pPage, livePatch *pPatch, param *pParam, int *pValue, int
         }
         else if (update & 2) {
             // Update midi mapping...
-            midiAssignments[midiCC[1]] = pParam->id;
+            midiAssignments[lastCC] = pParam->id;
             lcd.clear();
             lcd.print("Assigned CC");
             lcd.setCursor(0,1);
-            lcd.print(midiCC[1]);
+            lcd.print(lastCC);
             delay(1000);
             // ...and backout.
             *pPage = menu_param;
@@ -308,10 +471,11 @@ bool updateState(int *pPage, livePatch *pPatch, param *pParam, int *pValue, int
         else if (encoderVal > limit ) encoderVal = limit;
         else {
             *pValue = encoderVal;
-            updatePerfParam(pPatch, pParam->id, *pValue);
+            if (pParam->id != param_confirm) updatePerfParam(pPatch, pParam->id, *pValue);
         }
         return true;
     }
+    return false;
 }
 
 // Update the GUI based on system state change.
@@ -322,9 +486,8 @@ void updateMenu(int *pPage, livePatch *pPatch, param *pParam, int *pValue) {
     lcd.setCursor(0, 1);
 
     if (*pPage == menu_patch) {
-        char patchString[PATCHNAME_LEN] = {' '};
-        loadPatchName(*pValue, patchString);
-        lcd.print(patchString);
+        const char *name = patchName(&patchNames, &userPatches, *pValue);
+        if (name) lcd.print(name);
         lcd.setCursor(0, 1);
     }
     else if (*pPage == menu_param || *pPage == menu_value) {
@@ -349,6 +512,8 @@ boolean loadParamOption(param *pParam, int idx, char *pStr) {
     if (pParam->id == param_confirm) {
         if      (idx == 0) setString("Cancel", pStr, PARAMNAME_LEN);
         else if (idx == 1) setString("Yes", pStr, PARAMNAME_LEN);
+        else if (idx == 2) setString("Saved", pStr, PARAMNAME_LEN);
+        else if (idx == 3) setString("No room", pStr, PARAMNAME_LEN);
         else return false;
         return true;
     }
@@ -388,7 +553,7 @@ boolean loadParamOption(param *pParam, int idx, char *pStr) {
 
 boolean loadParam(int id, param *pParam) {
     if (id == param_confirm) {
-        param def = {PARAM_LABEL, id, "Save?"};
+        param def = {PARAM_LABEL | 2, id, "Save?"};
         return copyParam(&def, pParam);
     }
 
@@ -486,240 +651,144 @@ boolean loadParam(int id, param *pParam) {
 }
 
 // Patch methods
-bool loadPatchName(int id, char *pStr) {
-    livePatch p;
-    loadPatch(id, &p);
-    setString(p.patch.name, pStr, PATCHNAME_LEN);
-    return true;
+bool loadPatch(int id, livePatch *pProg) {
+    patchSettings s;
+    if (!loadPatchSettings(id, &s)) return false;
+    return copyPatch(&s, pProg);
 }
 
-bool loadPatch(int id, livePatch *pProg) {
-    // TODO user patches.
-    return loadFactoryDefaultPatch(id, pProg);
-}
-
-bool loadFactoryDefaultPatch(int id, livePatch *pProg) {
-    if (id == 0) {
-        patchSettings factory = {
-            0, 0, 8, 0, 8, 2, 1,
-            0, 0, 8, 0, 8, 2, 1, 0,
-            0, 0, 8, 0, 8, 2, 1, 0,
-            200, 0, 1, 0,
-            id, "Bleep",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 1) {
-        patchSettings factory = {
-            2, 2048, 12, 12, 15, 0, 1,
-            2, 2048, 12, 12, 15, 0, 1, 0,
-            2, 2048, 12, 12, 15, 0, 1, 0,
-            2000, 8, 0, 0,
-            id, "Spacey",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 2) {
-        patchSettings factory = {
-            1, 0, 1, 1, 4, 1, 1, 
-            2, 2048, 2, 4, 4, 2, 1, 0,
-            3, 0, 3, 4, 4, 3, 1, 0,
-            2047, 0, 0, 4,
-            id, "Belong",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 3) {
-        patchSettings factory = {
-            2, 2048, 0, 8, 0, 0, 1,
-            2, 2048, 0, 8, 0, 0, 1, 0,
-            2, 2048, 0, 8, 0, 0, 1, 0,
-            1024, 0, 0, 0,
-            id, "Disaste",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 4) {
-        patchSettings factory = {
-            1, 0, 0, 15, 14, 5, 1,
-            1, 0, 0, 15, 14, 5, 1, 4,
-            1, 0, 0, 15, 14, 5, 1, 8,
-            1024, 4, 0, 0,
-            id, "Sawbass",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 5) {
-        patchSettings factory = {
-            4, 0, 8, 0, 14, 2, 1,
-            0, 0, 8, 0, 14, 2, 1, 0,
-            0, 0, 0, 0, 0, 0, 1, 50,
-            200, 4, 1, 0,
-            id, "Bowser",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 6) {
-        patchSettings factory = {
-            2, 500,  12, 7, 0, 12, 1,
-            6, 1000, 12, 8, 0, 12, 1, 10,
-            6, 2000, 12, 9, 0, 12, 1, 20,
-            2000, 1, 0, 0,
-            id, "syncpad",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 7) {
-        patchSettings factory = {
-            7, 0, 1, 2, 10, 5, 1,
-            0, 0, 1, 4, 12, 5, 1, 0,
-            0, 0, 5, 4, 15, 8, 0, 50,
-            1320, 2, 3, 0,
-            id, "digi",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 8) {
-        patchSettings factory = {
-            0, 0, 3, 10, 5, 5, 1,
-            3, 0, 3, 10, 5, 5, 1, 1,
-            0, 0, 0, 0, 0, 0, 1, 50,
-            2000, 2, 0, 0,
-            id, "modmod",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 9) {
-        patchSettings factory = {
-            0, 0, 3, 3, 9, 6, 1,
-            4, 0, 3, 3, 9, 6, 1, 10,
-            0, 0, 0, 5, 3, 6, 1, 2,
-            2000, 2, 0, 0,
-            id, "sings",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 10) {
-        patchSettings factory = {
-            1, 0, 3, 3, 9, 6, 1,
-            5, 0, 3, 3, 9, 6, 1, 10,
-            5, 0, 0, 5, 3, 6, 1, 40,
-            700, 3, 1, 0,
-            id, "pluky",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 11) {
-        patchSettings factory = {
-            7, 0, 0, 3, 0, 0, 1,
-            3, 0, 1, 2, 13, 4, 1, 10,
-            3, 0, 1, 2, 13, 4, 1, 20,
-            1400, 2, 14, 0,
-            id, "boomer",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 12) {
-        patchSettings factory = {
-            7, 0, 0, 3, 0, 0, 1,
-            7, 0, 1, 2, 13, 4, 1, 5,
-            3, 0, 1, 2, 13, 4, 1, 1,
-            1400, 2, 1, 0,
-            id, "metalsc",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 13) {
-        patchSettings factory = {
-            0, 0, 1, 4, 13, 4, 1,
-            4, 0, 1, 4, 13, 6, 1, 60,
-            0, 0, 5, 2, 13, 4, 1, 2,
-            2000, 2, 0, 0,
-            id, "slider",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 14) {
-        patchSettings factory = {
-            0, 0, 4, 0, 15, 3, 1,
-            5, 0, 0, 3, 10, 0, 1, 10,
-            5, 0, 0, 3, 10, 0, 1, 8,
-            2000, 4, 0, 0,
-            id, "lowrm",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 15) {
-        patchSettings factory = {
-            0, 0, 4, 4, 12, 3, 0,
-            7, 0, 0, 0, 0, 0, 1, 0,
-            3, 0, 2, 4, 11, 0, 1, 2,
-            2000, 4, 0, 0,
-            id, "nring",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 16) {
-        patchSettings factory = {
-            0, 0, 1, 4, 12, 3, 0,
-            4, 0, 1, 4, 12, 0, 0, 5,
-            7, 0, 0, 4, 0, 0, 1, 0,
-            2000, 4, 2, 0,
-            id, "tin",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 17) {
-        patchSettings factory = {
-            2, 1400, 1, 4, 12, 3, 1,
-            2, 300,  1, 4, 12, 3, 1, 2,
-            3, 0,    0, 4, 10, 8, 0, 0,
-            2000, 0, 0, 0,
-            id, "pcomplx",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 18) {
-        patchSettings factory = {
-            3, 0,    1, 4, 8, 3, 1,
-            2, 1000, 1, 4, 8, 3, 1, 0,
-            3, 0,    1, 4, 8, 3, 0, 10,
-            2000, 0, 0, 0,
-            id, "rounds",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    else if (id == 19) {
-        patchSettings factory = {
-            0, 0, 4, 4, 8, 6, 0,
-            4, 0, 4, 4, 8, 6, 0, 2,
-            4, 0, 3, 4, 8, 3, 0, 64,
-            2000, 0, 1, 0,
-            id, "fff",
-        };
-        return copyPatch(&factory, pProg);
-    }
-    return false;
+bool loadPatchSettings(int id, patchSettings *pDest) {
+    if (id < 0 || id >= PATCH_BANK_LEN) return false;
+    if (loadUserPatch(&userPatches, id, pDest)) return true;
+    return loadFactoryPatch(id, pDest);
 }
 
 // SID management
-void writeSidRegister(byte loc, byte val) {
-    digitalWrite(sr_st_cp, LOW);
-    shiftOut(sr_ds , sr_sh_cp, LSBFIRST, loc);
-    shiftOut(sr_ds , sr_sh_cp, LSBFIRST, val);
-    digitalWrite(sr_st_cp, HIGH);
+// The pins and timing are up to the bus backend, see sidbus.h.
+void writeSidRegister(byte chip, byte loc, byte val) {
+    sidBus::write(chip, loc, val);
+    if (sidWriteTap) sidWriteTap(micros(), chip, loc, val);
+}
 
-    // Data is written as clock goes from high to low.
-    digitalWrite(sid_cs, LOW);
-    // As written the time between the `sid_cs` line going to low and back up to
-    // high is always at least three full cycle on the `mhz click` so more
-    // accurate tracking doesn't appear to be required.
-    digitalWrite(sid_cs, HIGH);
+#if SID_TRACE
+void serialTracePut(uint8_t b) {
+    Serial.write(b);
+}
+
+void serialTraceTap(unsigned long time, uint8_t chip, uint8_t reg, uint8_t val) {
+    traceSidWrite(&serialTrace, time, chip, reg, val);
+}
+#endif
+
+// Timer2: write the queued registers due on this tick, never splitting a
+// batch. Interrupts stay on, so a long tick (the shiftOut() bus) can't hold
+// up serial input; a tick arriving while the last one is still writing only
+// counts.
+ISR(TIMER2_COMPA_vect, ISR_NOBLOCK) {
+    static volatile bool busy = false;
+    uint16_t now = sidQueueTick(&sidWriteQueue);
+    if (busy) return;
+    busy = true;
+    queuedWrite w;
+    for (uint8_t n = 1; popSidWrite(&sidWriteQueue, now, &w); n++) {
+        writeSidRegister((w.reg & SID_WRITE_CHIP) >> 5, w.reg & 0x1F, w.val);
+        if (n >= SID_WRITES_PER_TICK && !(w.reg & SID_WRITE_MORE)) break;
+    }
+    busy = false;
 }
 
-// Wrapper around writeSidRegister, forces changes to be in livepatch.registers
+// The tick a change caused at `time` (micros()) is written on: a fixed
+// latency later, so its timing doesn't depend on the pass that handled it.
+// Anything already later than that goes out on the next tick.
+uint16_t sidDue(unsigned long time) {
+    uint16_t now = sidQueueNow(&sidWriteQueue);
+    unsigned long age = (micros() - time) / SID_TICK_US;
+    if (age >= SID_WRITE_LATENCY) return now + 1;
+    return now + SID_WRITE_LATENCY - age;
+}
+
+// Register transactions. Changes to livePatch.registers, and each chip's own
+// in livePatch.chips, are staged with writeSR() or writeChipSR() and reach
+// the chips at commitSR(), each register once with its final value, all on
+// one tick. beginSR() and commitSR() pair up and nest, only the outermost
+// commit flushes; a commitSR() outside any beginSR() flushes whatever has
+// been staged.
+void beginSR(livePatch *p) {
+    p->depth++;
+}
+
+// Stage a patch register on every chip, forces changes to be in
+// livepatch.registers. Frequencies are each chip's own and are staged as
+// they are.
 void writeSR(livePatch *p, uint8_t i) {
-    writeSidRegister(i, p->registers[i]);
+    bool freq = i < 21 && i % 7 < 2;
+    for (uint8_t c = 0; c < SID_CHIPS; c++) {
+        if (!freq) p->chips[c].registers[i] = p->registers[i];
+        writeChipSR(p, c, i);
+    }
+}
+
+// Stage a register of chip `c`, forces changes to be in its registers.
+void writeChipSR(livePatch *p, uint8_t c, uint8_t i) {
+    sidChip *chip = &p->chips[c];
+    chip->staged |= 1UL << i;
+    // A gate closed and opened again before the commit still retriggers.
+    if (i < 21 && i % 7 == 4 && !(chip->registers[i] & 1)) chip->gateClosed |= 1 << (i / 7);
+}
+
+// Add register `i` of chip `c` to a flush if the chip doesn't already hold
+// `val`.
+static uint8_t stageFlush(uint8_t *regs, uint8_t *vals, uint8_t n, uint8_t c, uint8_t i, uint8_t val) {
+    uint32_t bit = 1UL << i;
+    if (!(sidUnknown[c] & bit) && sidShadow[c][i] == val) return n;
+    regs[n] = i | c << 5;
+    vals[n] = val;
+    sidShadow[c][i] = val;
+    sidUnknown[c] &= ~bit;
+    return n + 1;
+}
+
+// Close a transaction; the outermost queues the staged registers for tick
+// `due`, a batch per chip, in an order that is safe for the chip: gates
+// closing first, so a retriggered voice is released before its pitch moves;
+// then envelopes, pulse widths, filter and volume; then each frequency, low
+// and high byte together; and control registers (gates opening) last, so a
+// note starts with everything else in place.
+void commitSR(livePatch *p, uint16_t due) {
+    static const uint8_t order[22] = {
+        5, 6, 12, 13, 19, 20,   // Envelopes
+        2, 3, 9, 10, 16, 17,    // Pulse widths
+        21, 22, 23, 24,         // Filter, volume
+        0, 1, 7, 8, 14, 15,     // Frequencies
+    };
+    if (p->depth && --p->depth) return;
+
+    for (uint8_t c = 0; c < SID_CHIPS; c++) {
+        sidChip *chip = &p->chips[c];
+        uint8_t regs[28], vals[28], n = 0;
+        for (uint8_t v = 0; v < 3; v++) {
+            uint8_t i = v * 7 + 4;
+            if (!(chip->staged & (1UL << i))) continue;
+            if (!(chip->registers[i] & 1)) {
+                n = stageFlush(regs, vals, n, c, i, chip->registers[i]);
+            }
+            else if (chip->gateClosed & (1 << v)) {
+                // Closing before opening again: keep the waveform the chip has.
+                uint8_t closed = (sidUnknown[c] & (1UL << i)) ? chip->registers[i] : sidShadow[c][i];
+                n = stageFlush(regs, vals, n, c, i, closed & 0xFE);
+            }
+        }
+        for (uint8_t k = 0; k < sizeof(order); k++) {
+            uint8_t i = order[k];
+            if (chip->staged & (1UL << i)) n = stageFlush(regs, vals, n, c, i, chip->registers[i]);
+        }
+        for (uint8_t i = 4; i < 21; i += 7) {
+            if (chip->staged & (1UL << i)) n = stageFlush(regs, vals, n, c, i, chip->registers[i]);
+        }
+        pushSidWrites(&sidWriteQueue, regs, vals, n, due);
+        chip->staged = 0;
+        chip->gateClosed = 0;
+    }
 }
 
 void updateSynth(livePatch *p) {
@@ -734,103 +803,187 @@ void updateSynth(livePatch *p) {
     }
 }
 
-void noteToRegisters(livePatch *p, char osc) {
+// Switch the live patch to program `program` and queue, for tick `due`, only
+// the registers that differ from the outgoing patch's. Every gate is staged
+// closed as well, releasing held notes as a full rewrite would, and
+// commitSR() sends the closing gates ahead of the envelopes that change
+// under them. Frequencies are left to the notes. commitSR() drops whatever a
+// chip already holds, so an unchanged register costs no bus write. False if
+// there is no such program.
+bool changeProgram(livePatch *p, int program, uint16_t due) {
+    uint8_t outgoing[25];
+    uint8_t volume[SID_CHIPS];
+    memcpy(outgoing, p->registers, sizeof(outgoing));
+    for (uint8_t c = 0; c < SID_CHIPS; c++) volume[c] = p->chips[c].registers[24] & 0x0F;
+    if (!loadPatch(program, p)) return false;
+
+    beginSR(p);
+    for (uint8_t i = 0; i < 25; i++) {
+        bool freq = i < 21 && i % 7 < 2;
+        bool control = i < 21 && i % 7 == 4;
+        if (!freq && (control || p->registers[i] != outgoing[i])) writeSR(p, i);
+    }
+    // A new filter mode keeps each chip's volume, set by its last note, so
+    // the released notes fade out rather than cut.
+    for (uint8_t c = 0; c < SID_CHIPS; c++) p->chips[c].registers[24] |= volume[c];
+    commitSR(p, due);
+    return true;
+}
+
+// Pitch chip `c`'s oscillators for its note.
+void noteToRegisters(livePatch *p, uint8_t c, char osc) {
     // Values for C7 through B7.
     // B7, G7 & G#7 intentionally differ from the hex values in the data sheet
     const uint32_t octave[12] = {0x892B, 0x9153, 0x99F7, 0xA31F, 0xACD2, 0xB719, 0xC1FC,
         0xCD85, 0xD9BD, 0xE6B0, 0xF467, 0x102F0};
 
-    uint32_t note = octave[p->note % 12];
-    int shift = (7 - (p->note / 12));
+    sidChip *chip = &p->chips[c];
+    uint32_t note = octave[chip->note % 12];
+    int shift = (7 - (chip->note / 12));
     note = note >> shift;
 
     // 'u' is for unison! ...and updates all registers.
     if (osc == 'u' || osc == 'a') {
         // Currently no detune for osc a
-        p->registers[0] = note & 0xFF;
-        p->registers[1] = note >> 8;
+        chip->registers[0] = note & 0xFF;
+        chip->registers[1] = note >> 8;
     }
     if (osc == 'u' || osc == 'b') {
         uint16_t n = note;
-        if (p->patch.detuneOscB){
-            n = n * pow(2, (float)p->patch.detuneOscB / 120);
+        int detune = loadPatchValue(PATCH_DETUNE_B, p);
+        if (detune) {
+            n = n * pow(2, (float)detune / 120);
         }
-        p->registers[7] = n & 0xFF;
-        p->registers[8] = n >> 8;
+        chip->registers[7] = n & 0xFF;
+        chip->registers[8] = n >> 8;
     }
     if (osc == 'u' || osc == 'c') {
         uint16_t n = note;
-        if (p->patch.detuneOscC) {
-            n = n * pow(2, (float)p->patch.detuneOscC / 120);
+        int detune = loadPatchValue(PATCH_DETUNE_C, p);
+        if (detune) {
+            n = n * pow(2, (float)detune / 120);
         }
-        p->registers[14] = n & 0xFF;
-        p->registers[15] = n >> 8;
+        chip->registers[14] = n & 0xFF;
+        chip->registers[15] = n >> 8;
     }
 }
 
-// Return NO_PARAM or the parameter id played.
+// Drain every queued MIDI event into the synth.
+// Return NO_PARAM or the id of the last parameter played.
 uint8_t updatePerformance(livePatch *p) {
     // Control registers.
     const uint8_t controlReg[3] = {4, 11, 18};
     // Frequency registers
     const uint8_t freqReg[3][2] = {{0, 1}, {7, 8}, {14, 15}};
-    static uint8_t lastNote = 0; // first bit is on/off, 7-bits are note.
+    // Per chip, first bit is on/off, 7-bits are note.
+    static uint8_t lastNote[SID_CHIPS];
+    // Per chip, noteCount when its note last started or stopped.
+    static uint16_t lastChange[SID_CHIPS];
+    static uint16_t noteCount = 0;
+    uint8_t played = NO_PARAM;
+    bool changed = false;       // Controller changes not yet committed,
+    unsigned long changedAt = 0; // and when the first of them arrived.
+    midiEvent e;
 
     // Ignore MIDI channels for now.
-    if (midiNotePlayed) {
-        midiNotePlayed = false;
-        
-        // Control registers
-        if (midiOn[2] > 0) {
-            p->note = midiOn[1];
-            noteToRegisters(p, 'u');
-            for (int i = 0; i < 3; i++) {
-                writeSR(p, freqReg[i][0]);
-                writeSR(p, freqReg[i][1]);
+    while (popEvent(&midiEvents, &e)) {
+        if (e.type == ControlChange) {
+            lastCC = e.data1;
+            if (midiAssignments[e.data1] != NO_PARAM) {
+                param target;
+                loadParam(midiAssignments[e.data1], &target);
+                int v = (float)e.data2 / 127 * (float)(paramLimit(&target));
+                updatePerfParam(p, target.id, v);
+                played = target.id;
+                if (!changed) changedAt = e.time;
+                changed = true;
             }
+        }
+        else if (e.type == ProgramChange) {
+            if (changeProgram(p, e.data1, sidDue(e.time))) changed = false;
+        }
+        else if (e.type == NoteOn && e.data2 > 0) {
+#if SID_VOICES == SID_VOICES_LAYER
+            uint8_t first = 0, last = SID_CHIPS - 1;
+            (void)lastChange; // Only the poly allocation reads it.
+#else
+            // The chip already playing this note, else the one free longest,
+            // else the one playing longest.
+            uint8_t first = 0;
+            for (uint8_t c = 1; c < SID_CHIPS; c++) {
+                if (lastNote[first] == (e.data1 | 0x80)) break;
+                bool better = lastNote[c] == (e.data1 | 0x80)
+                    || (!lastNote[c] && lastNote[first])
+                    || (!lastNote[c] == !lastNote[first]
+                        && (uint16_t)(noteCount - lastChange[c]) > (uint16_t)(noteCount - lastChange[first]));
+                if (better) first = c;
+            }
+            uint8_t last = first;
+#endif
+            beginSR(p);
+            for (uint8_t c = first; c <= last; c++) {
+                sidChip *chip = &p->chips[c];
+                chip->note = e.data1;
+                noteToRegisters(p, c, 'u');
+                for (int i = 0; i < 3; i++) {
+                    writeChipSR(p, c, freqReg[i][0]);
+                    writeChipSR(p, c, freqReg[i][1]);
+                }
 
-            // Volume
-            p->registers[24] |= ((midiOn[2] >> 3) + p->patch.volume) & 0xF;
-            writeSR(p, 24);
+                // Volume
+                chip->registers[24] |= ((e.data2 >> 3) + loadPatchValue(PATCH_VOLUME, p)) & 0xF;
+                writeChipSR(p, c, 24);
 
-            for (int i = 0; i < 3; i++) { // Open gates
-                if (lastNote) {
-                    p->registers[controlReg[i]] &= 0xFE;
-                    writeSR(p, controlReg[i]);
+                if (lastNote[c]) {
+                    for (int i = 0; i < 3; i++) { // Close gates, to retrigger
+                        chip->registers[controlReg[i]] &= 0xFE;
+                        writeChipSR(p, c, controlReg[i]);
+                    }
                 }
-                p->registers[controlReg[i]] |= 0x1;
-                writeSR(p, controlReg[i]);
+                for (int i = 0; i < 3; i++) { // Open gates
+                    chip->registers[controlReg[i]] |= 0x1;
+                    writeChipSR(p, c, controlReg[i]);
+                }
+                lastNote[c] = e.data1 | 0x80;
+                lastChange[c] = noteCount;
             }
-            lastNote = midiOn[1] | 0x80;
+            // The closed gates go out first, then pitch and volume, then the
+            // open gates, all on one tick. Gate changes are committed straight
+            // away, so none is lost to a later event in the same pass.
+            commitSR(p, sidDue(e.time));
+            changed = false;
+            noteCount++;
         }
-        else if (lastNote == (midiOn[1] | 0x80)) {
-            for (int i = 0; i < 3; i++) { // Close gates
-                p->registers[controlReg[i]] &= 0xFE;
-                writeSR(p, controlReg[i]);
+        else {
+            bool released = false;
+            for (uint8_t c = 0; c < SID_CHIPS; c++) {
+                if (lastNote[c] != (e.data1 | 0x80)) continue;
+                if (!released) beginSR(p);
+                released = true;
+                for (int i = 0; i < 3; i++) { // Close gates
+                    p->chips[c].registers[controlReg[i]] &= 0xFE;
+                    writeChipSR(p, c, controlReg[i]);
+                }
+                lastNote[c] = 0;
+                lastChange[c] = noteCount;
+            }
+            if (released) {
+                commitSR(p, sidDue(e.time));
+                changed = false;
+                noteCount++;
             }
-            lastNote = 0;
-        }
-    }
-
-    if (midiControlPlayed) {
-        midiControlPlayed = false;
-        if (midiAssignments[midiCC[1]] != NO_PARAM) {
-            param target;
-            loadParam(midiAssignments[midiCC[1]], &target);
-            int v = (float)midiCC[2] / 127 * (float)(paramLimit(&target));
-            updatePerfParam(p, target.id, v);
-            return target.id;
         }
     }
-    return NO_PARAM;
+    if (changed) commitSR(p, sidDue(changedAt));
+    return played;
 }
 
 void updatePerfParam(livePatch *pPatch, int param, int val) {
     setPatchValue(pPatch, param, val);
-    if (param == 14 || param == 22) {
+    if (param == PATCH_DETUNE_B || param == PATCH_DETUNE_C) {
         // Detune is a special case for now, should be able to move noteToRegisters
         // and this logic over to patch.h 
-        noteToRegisters(pPatch, param == 14 ? 'b' : 'c');
+        for (uint8_t c = 0; c < SID_CHIPS; c++) noteToRegisters(pPatch, c, param == PATCH_DETUNE_B ? 'b' : 'c');
     }
     int loc = patchParamRegister(param);
     writeSR(pPatch, loc & 0xFF);
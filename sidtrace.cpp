@@ -0,0 +1,55 @@
+#include "sidtrace.h"
+
+static const uint8_t magic[4] = {'S', 'I', 'D', 'T'};
+
+void beginSidTrace(sidTrace *t, void (*put)(uint8_t b), uint32_t clockHz) {
+    t->put = put;
+    t->last = 0;
+    for (uint8_t i = 0; i < 4; i++) put(magic[i]);
+    put(SIDTRACE_VERSION);
+    for (uint8_t i = 0; i < 4; i++, clockHz >>= 8) put(clockHz & 0xFF);
+}
+
+void traceSidWrite(sidTrace *t, unsigned long time, uint8_t chip, uint8_t reg, uint8_t val) {
+    // Time only goes forwards.
+    unsigned long delta = (long)(time - t->last) > 0 ? time - t->last : 0;
+    t->last += delta;
+    t->put((reg & 0x1F) | (chip & 3) << 5 | (delta ? 0x80 : 0));
+    while (delta) {
+        uint8_t b = delta & 0x7F;
+        delta >>= 7;
+        t->put(delta ? b | 0x80 : b);
+    }
+    t->put(val);
+}
+
+int readSidTraceHeader(const uint8_t *p, unsigned long len, uint32_t *pClockHz) {
+    if (len < SIDTRACE_HEADER_LEN) return 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        if (p[i] != magic[i]) return 0;
+    }
+    if (p[4] < 1 || p[4] > SIDTRACE_VERSION) return 0;
+    *pClockHz = (uint32_t)p[5] | (uint32_t)p[6] << 8 | (uint32_t)p[7] << 16 | (uint32_t)p[8] << 24;
+    return SIDTRACE_HEADER_LEN;
+}
+
+int readSidTraceRecord(const uint8_t *p, unsigned long len, sidTraceRecord *pRecord) {
+    unsigned long i = 0;
+    if (len < 2) return 0;
+    uint8_t flags = p[i++];
+    unsigned long delta = 0;
+    if (flags & 0x80) {
+        uint8_t shift = 0;
+        do {
+            if (i == len || shift > 28) return 0;
+            delta |= (unsigned long)(p[i] & 0x7F) << shift;
+            shift += 7;
+        } while (p[i++] & 0x80);
+    }
+    if (i == len) return 0;
+    pRecord->time += delta;
+    pRecord->chip = (flags >> 5) & 3;
+    pRecord->reg = flags & 0x1F;
+    pRecord->val = p[i++];
+    return i;
+}
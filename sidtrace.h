@@ -0,0 +1,49 @@
+/*
+ * A compact binary log of SID register writes.
+ *
+ * A trace starts with a 9 byte header: "SIDT", a version byte (2) and the
+ * SID clock in Hz, 32 bits little endian. One record per write follows:
+ *
+ *   flags     bits 0-4 the register, bits 5-6 the chip, bit 7 set if a time
+ *             delta follows
+ *   delta     microseconds since the previous write (or since the trace
+ *             clock's zero, for the first), 7 bits a byte, least significant
+ *             first, the top bit set on every byte but the last
+ *   value
+ *
+ * Writes on the same tick take two bytes, the first of a tick four. Version
+ * 1 traces, from before there was more than one chip, read as all chip 0.
+ */
+#ifndef SIDTRACE_H_
+#define SIDTRACE_H_
+
+#include <inttypes.h>
+
+#define SIDTRACE_VERSION 2
+#define SIDTRACE_HEADER_LEN 9
+
+struct sidTrace {
+    void (*put)(uint8_t b);     // Where the bytes go.
+    unsigned long last;         // Time of the previous write.
+};
+
+struct sidTraceRecord {
+    unsigned long time;
+    uint8_t chip;
+    uint8_t reg;
+    uint8_t val;
+};
+
+// Recording. Writes the header through `put`.
+void beginSidTrace(sidTrace *t, void (*put)(uint8_t b), uint32_t clockHz);
+void traceSidWrite(sidTrace *t, unsigned long time, uint8_t chip, uint8_t reg, uint8_t val);
+
+// Playback, from a trace in memory. Returns the header length, or 0 if `p`
+// doesn't start with a trace header of version 1 or 2.
+int readSidTraceHeader(const uint8_t *p, unsigned long len, uint32_t *pClockHz);
+
+// Decode the record at `p`, continuing from the time in `pRecord`. Returns
+// the bytes used, or 0 if the record is cut short or invalid.
+int readSidTraceRecord(const uint8_t *p, unsigned long len, sidTraceRecord *pRecord);
+
+#endif // SIDTRACE_H_
@@ -0,0 +1,171 @@
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/eeprom.h>
+#include "patch.h"
+#include "bank.h"
+#include "userbank.h"
+
+#define USER_MAGIC 0x53
+
+// A record has to fill its slot exactly.
+typedef char userRecordFitsSlot[sizeof(userRecord) == USER_SLOT_LEN ? 1 : -1];
+
+static uint8_t *slotAddress(uint8_t slot, uint8_t offset) {
+    return (uint8_t *)(size_t)(slot * USER_SLOT_LEN + offset);
+}
+
+// Of the bytes from magic to the name.
+static uint8_t recordSum(const userRecord *r) {
+    const uint8_t *p = &r->magic;
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < offsetof(userRecord, check) - offsetof(userRecord, magic); i++) sum += p[i];
+    return sum;
+}
+
+static uint32_t recordSeq(const uint8_t *seq) {
+    return seq[0] | (uint32_t)seq[1] << 8 | (uint32_t)seq[2] << 16 | (uint32_t)seq[3] << 24;
+}
+
+static uint32_t slotSeq(uint8_t slot) {
+    uint8_t seq[4];
+    eeprom_read_block(seq, slotAddress(slot, offsetof(userRecord, seq)), sizeof(seq));
+    return recordSeq(seq);
+}
+
+// The slot holding `program` live, or USER_FREE.
+static uint8_t findSlot(const userBank *b, uint8_t program) {
+    for (uint8_t s = 0; s < USER_SLOTS; s++) {
+        if (b->programs[s] == program) return s;
+    }
+    return USER_FREE;
+}
+
+// The newest queued save of `program`, or NULL.
+static const userRecord *findQueued(const userBank *b, uint8_t program) {
+    for (uint8_t i = b->head; i != b->tail; ) {
+        const userRecord *r = &b->queue[--i & (USER_QUEUE_LEN - 1)];
+        if (r->program == program) return r;
+    }
+    return NULL;
+}
+
+void beginUserBank(userBank *b) {
+    memset(b, 0, sizeof(*b));
+    uint8_t newest = USER_SLOTS - 1;
+    for (uint8_t s = 0; s < USER_SLOTS; s++) {
+        userRecord r;
+        eeprom_read_block(&r, slotAddress(s, 0), sizeof(r));
+        b->programs[s] = USER_FREE;
+        if (r.program >= PATCH_BANK_LEN || r.magic != USER_MAGIC) continue;
+        if ((uint8_t)(recordSum(&r) + r.check) != 0) continue;
+
+        // A save cut short after its new record was complete leaves two.
+        uint32_t seq = recordSeq(r.seq);
+        uint8_t other = findSlot(b, r.program);
+        if (other != USER_FREE) {
+            if (slotSeq(other) > seq) continue;
+            b->programs[other] = USER_FREE;
+        }
+        b->programs[s] = r.program;
+        if (seq >= b->seq) {
+            b->seq = seq;
+            newest = s;
+        }
+    }
+    b->next = (newest + 1) % USER_SLOTS;
+}
+
+bool loadUserPatch(const userBank *b, uint8_t program, patchSettings *pDest) {
+    const userRecord *r = findQueued(b, program);
+    if (r) {
+        memcpy(pDest->values, r->values, PATCH_VALUES_LEN);
+        memcpy(pDest->name, r->name, PATCHNAME_LEN);
+    }
+    else {
+        uint8_t s = findSlot(b, program);
+        if (s == USER_FREE) return false;
+        eeprom_read_block(pDest->values, slotAddress(s, offsetof(userRecord, values)), PATCH_VALUES_LEN);
+        eeprom_read_block(pDest->name, slotAddress(s, offsetof(userRecord, name)), PATCHNAME_LEN);
+    }
+    pDest->id = program;
+    return true;
+}
+
+bool loadUserPatchName(const userBank *b, uint8_t program, char *pName) {
+    const userRecord *r = findQueued(b, program);
+    if (r) {
+        memcpy(pName, r->name, PATCHNAME_LEN);
+        return true;
+    }
+    uint8_t s = findSlot(b, program);
+    if (s == USER_FREE) return false;
+    eeprom_read_block(pName, slotAddress(s, offsetof(userRecord, name)), PATCHNAME_LEN);
+    return true;
+}
+
+bool saveUserPatch(userBank *b, const patchSettings *s) {
+    if (s->id >= PATCH_BANK_LEN) return false;
+
+    // A queued save that hasn't started can take the new values.
+    userRecord *r = NULL;
+    uint8_t added = 0;  // Queued programs with no live slot yet.
+    for (uint8_t i = b->tail; i != b->head; i++) {
+        userRecord *q = &b->queue[i & (USER_QUEUE_LEN - 1)];
+        if (q->program == s->id && (i != b->tail || b->step == 0)) r = q;
+        if (findSlot(b, q->program) == USER_FREE) added++;
+    }
+
+    if (!r) {
+        if ((uint8_t)(b->head - b->tail) == USER_QUEUE_LEN) return false;
+        if (findSlot(b, s->id) == USER_FREE) {
+            uint8_t live = 0;
+            for (uint8_t i = 0; i < USER_SLOTS; i++) live += b->programs[i] != USER_FREE;
+            if (live + added + 1 >= USER_SLOTS) return false;
+        }
+        r = &b->queue[b->head & (USER_QUEUE_LEN - 1)];
+        r->program = s->id;
+        r->magic = USER_MAGIC;
+        uint32_t seq = ++b->seq;
+        for (uint8_t i = 0; i < sizeof(r->seq); i++, seq >>= 8) r->seq[i] = seq;
+        b->head++;
+    }
+    memcpy(r->values, s->values, PATCH_VALUES_LEN);
+    memcpy(r->name, s->name, PATCHNAME_LEN);
+    r->check = -recordSum(r);
+    return true;
+}
+
+bool userBankIdle(userBank *b) {
+    if (b->head == b->tail) return false;
+    if (!eeprom_is_ready()) return true;
+
+    const userRecord *r = &b->queue[b->tail & (USER_QUEUE_LEN - 1)];
+    if (b->step == 0) {
+        b->slot = b->next;
+        while (b->programs[b->slot] != USER_FREE) b->slot = (b->slot + 1) % USER_SLOTS;
+    }
+
+    // The program byte is cleared first and written last, so the slot only
+    // holds a record once all of it is there. Bytes that already hold their
+    // value are passed over, which costs no time and no wear.
+    const uint8_t *bytes = (const uint8_t *)r;
+    while (b->step <= USER_SLOT_LEN) {
+        uint8_t offset = b->step % USER_SLOT_LEN;
+        uint8_t val = b->step == 0 ? USER_FREE : bytes[offset];
+        uint8_t *addr = slotAddress(b->slot, offset);
+        b->step++;
+        if (eeprom_read_byte(addr) != val) {
+            eeprom_write_byte(addr, val);
+            if (b->step <= USER_SLOT_LEN) return true;
+        }
+    }
+
+    uint8_t old = findSlot(b, r->program);
+    if (old != USER_FREE) b->programs[old] = USER_FREE;
+    b->programs[b->slot] = r->program;
+    b->next = (b->slot + 1) % USER_SLOTS;
+    b->step = 0;
+    b->tail++;
+    return b->head != b->tail;
+}
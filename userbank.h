@@ -0,0 +1,67 @@
+/*
+ * User patches, saved over the factory programs of the same number and kept
+ * in EEPROM, in the packed format (patch.h).
+ *
+ * The EEPROM is a ring of USER_SLOTS slots of one record each. A save never
+ * rewrites the record it replaces: it goes to the next slot round the ring
+ * that holds nothing live, and the old record is only dropped once the new
+ * one is complete, so every free slot takes its turn and a power cut mid
+ * save leaves the last good copy. With n programs saved, each slot is
+ * written once every USER_SLOTS - n saves.
+ *
+ * Writing a byte takes the EEPROM 3.4ms, so saves are not written there and
+ * then: saveUserPatch() queues the record and userBankIdle(), called when
+ * loop() has nothing better to do, starts one byte write each time the
+ * EEPROM is ready, never waiting for it. Loads see queued saves straight
+ * away.
+ */
+#ifndef USERBANK_H_
+#define USERBANK_H_
+
+#include <inttypes.h>
+
+#define USER_SLOT_LEN 32     // Bytes a record takes, sizeof(userRecord).
+#define USER_SLOTS 32        // (E2END + 1) / USER_SLOT_LEN.
+#define USER_QUEUE_LEN 2     // Saves waiting to be written.
+#define USER_FREE 0xFF       // In userBank.programs: no live record.
+
+// A record as it is stored, all bytes so the layout is the same everywhere.
+struct userRecord {
+    uint8_t program;    // Written last: USER_FREE until the rest is there.
+    uint8_t magic;      // USER_MAGIC, or not a record.
+    uint8_t seq[4];     // Saves before this one, least significant first.
+    uint8_t values[PATCH_VALUES_LEN];
+    char name[PATCHNAME_LEN];
+    uint8_t check;      // Makes the bytes from magic on sum to zero.
+};
+
+struct userBank {
+    uint8_t programs[USER_SLOTS];  // Program each slot holds live, or USER_FREE.
+    uint32_t seq;                  // The newest record's.
+    uint8_t next;                  // Slot the next save starts looking from.
+
+    // Write-behind queue, oldest at tail.
+    userRecord queue[USER_QUEUE_LEN];
+    uint8_t head;
+    uint8_t tail;
+    uint8_t slot;                  // Where queue[tail] is going.
+    uint8_t step;                  // Bytes of queue[tail] written so far.
+};
+
+// Find the live records in the EEPROM.
+void beginUserBank(userBank *b);
+
+// The saved patch for `program`, if there is one.
+bool loadUserPatch(const userBank *b, uint8_t program, patchSettings *pDest);
+bool loadUserPatchName(const userBank *b, uint8_t program, char *pName);
+
+// Queue `s` to be saved as program s->id. A save of a program already
+// waiting replaces it. False if the queue is full or every slot would be
+// live, which would leave nowhere to write the next save.
+bool saveUserPatch(userBank *b, const patchSettings *s);
+
+// Start the next byte write if the EEPROM is ready. True while saves are
+// still to be written.
+bool userBankIdle(userBank *b);
+
+#endif // USERBANK_H_